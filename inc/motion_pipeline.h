@@ -20,6 +20,29 @@ typedef struct _B_Scale
 	Real scaleZ;
 } B_Scale;
 
+// the counters of the posture graph of an IK group since the last ik_pg_stats_reset
+typedef struct _PG_Stats
+{
+	const char* group;						// the name of the root body of the group
+	unsigned long long n_searches;			// updates the primary IK failed and the graph was searched
+	unsigned long long n_errs;				// error evaluations of the searches
+	unsigned long long n_localMinima;		// local minima the searches hit
+	unsigned long long n_restarts;			// secondary IK restarts, from the local minima and the task space index
+	unsigned long long n_exhausted;			// searches stopped by the radius or the deadline
+	unsigned long long n_expired;			// searches stopped by the deadline (PG_budget_us)
+	unsigned long long us_searchTotal;		// the time of the searches with a deadline
+	unsigned long long us_searchMax;
+	unsigned long long n_postureChanges;	// active posture changes applied from the projections
+	unsigned long long n_projections;
+	unsigned long long n_projExhausted;		// projections stopped by the radius or the deadline
+	unsigned long long n_projExpired;		// projections stopped by the deadline
+	unsigned long long us_projSearchTotal;	// the time of the projection searches with a deadline
+	unsigned long long us_projSearchMax;
+	unsigned long long us_projTotal;		// the latency of a projection: from its request to its result
+	unsigned long long us_projMax;
+	unsigned long long n_overlayTaken;		// the overlay vertices taken into the searches (PG_augment)
+} PG_Stats;
+
 typedef HIKLIB_CB(HBODY, *FuncBodyInit)(void* paramProc
 									, const wchar_t* filePath
 									, const wchar_t* namesOnPair[]
@@ -35,6 +58,11 @@ HIKLIB(void,			fk_update)(MotionPipe* mopipe, unsigned int i_frame);
 HIKLIB(bool,			ik_task_update)(HBODY body_t, const _TRANSFORM* tm);
 HIKLIB(void,			ik_update)(MotionPipe* mopipe);
 HIKLIB(void,			ik_reset)(MotionPipe* mopipe);
+HIKLIB(bool,			ik_pg_ready)(MotionPipe* mopipe); // false if a posture graph is still being loaded (PG_async="1")
+// called on the thread of ik_update, stats of at most n_stats groups with posture graphs are written,
+// returns the number of groups with posture graphs, 0 for the library built without PG_STATS
+HIKLIB(int,				ik_pg_stats)(MotionPipe* mopipe, PG_Stats* stats, int n_stats);
+HIKLIB(void,			ik_pg_stats_reset)(MotionPipe* mopipe);
 
 // these APIs are not for game engine usage
 HIKLIB(HMOTIONNODE,		create_tree_motion_node)(HBODY mo_src);
@@ -22,6 +22,8 @@ HIKLIB(HPG, posture_graph_load)(const char* pg_dir_0, const char* pg_name);
 HIKLIB(void, posture_graph_release)(HPG hPG);
 HIKLIB(HPG, posture_graph_merge)(HPG pg_0, HPG pg_1, const char* confXML, Real eps_err); // hg = hg_0 U hg_1
 HIKLIB(bool, posture_graph_save)(HPG hpg, const char* dir_out);
+HIKLIB(bool, posture_graph_bound_degree)(HPG hpg, int deg_max); // keeps the deg_max closest neighbors of a vertex over a spanning backbone, before posture_graph_save
+HIKLIB(bool, posture_graph_add_shortcuts)(HPG hpg, int n_links); // adds long-range shortcut edges of n_links per vertex, before posture_graph_save
 HIKLIB(bool, convert_pg2dot)(const char* path_src, const char* path_dst);
 HIKLIB(int, N_Theta)(HPG pg);
 HIKLIB(bool, remove_theta_noise)(const char* path_src, const char* path_dst, const char* path_interests_conf);
@@ -0,0 +1,388 @@
+// ik_alloc_check.cpp: counts the heap allocations on the thread of ik_update after a warm-up,
+//	with the posture graphs of a motion pipe loaded, an allocation in a steady frame fails the check.
+//		ik_alloc_check <conf.xml> [n_warmup=200] [n_frames=2000] [reach=0.5]
+//	the library sources are built into this executable, so the operator new replaced here sees their allocations,
+//	Eigen reports its heap allocations through EIGEN_RUNTIME_NO_MALLOC, see ik_alloc_check.h.
+//	the destination of the conf is read from the bvh file of its name, the posture graphs are the PG_dir of the IK body,
+//	a case runs a copy of the conf with the PG_* attributes of the IK body overridden:
+//		proj:		the projection workers, the theta of the body is sent from the IK thread (GetRefBodyTheta)
+//		shared:		2 pipelines on the projection service of the graph
+//		knn:		the restarts seeded by the task space index
+//		resume:		LocalMin_resume
+//		augment:	2 pipelines growing 1 overlay, the frames taking the grown overlay are outside the steady state
+//	the targets sweep around their rest positions by reach times their distance from the root,
+//	a case fails if it allocates in a steady frame or if the paths of the case are not taken
+#include "pch.h"
+#include <new>
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include <locale>
+#include <codecvt>
+#include "motion_pipeline.h"
+#include "articulated_body.h"
+#include "bvh.h"
+#include "tinyxml.h"
+#include "Math.hpp"
+
+HMODULE g_Module = NULL;
+
+static thread_local bool t_counting = false;
+static thread_local long t_news = 0;
+static thread_local long t_eigens = 0;
+static thread_local const char* t_eigenExpr = NULL;
+
+void* operator new(std::size_t size)
+{
+	if (t_counting)
+		t_news ++;
+	void* p = malloc(size > 0 ? size : 1);
+	if (NULL == p)
+		throw std::bad_alloc();
+	return p;
+}
+
+void* operator new[](std::size_t size)
+{
+	return operator new(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+	if (t_counting)
+		t_news ++;
+	return malloc(size > 0 ? size : 1);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t& nothrow) noexcept
+{
+	return operator new(size, nothrow);
+}
+
+void operator delete(void* p) noexcept
+{
+	free(p);
+}
+
+void operator delete[](void* p) noexcept
+{
+	free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept
+{
+	free(p);
+}
+
+void operator delete[](void* p, std::size_t) noexcept
+{
+	free(p);
+}
+
+extern "C" void IKAllocCheck_EigenAssert(const char* expr)
+{
+	if (t_counting)
+	{
+		t_eigens ++;
+		t_eigenExpr = expr;
+	}
+}
+
+struct Case
+{
+	const char* name;
+	int n_pipes;
+	const char* attrs[4][2];	// the PG_* attributes over c_attrsBase, NULL terminated
+	bool proj;					// the projections run
+	bool seeded;				// the restarts are seeded by the task space index
+	bool overlay;				// the overlay is grown
+};
+
+static const char* c_attrsBase[][2] = {
+	{"PG_async", "0"},
+	{"PG_proj_concurrency", "1"},
+	{"PG_proj_shared", "0"},
+	{"PG_knn", "0"},
+	{"PG_resume_dist", "0"},
+	{"PG_augment", "0"},
+	{"PG_augment_save", "0"},
+};
+
+static const Case c_cases[] = {
+	{"proj",	1, {{"PG_proj_concurrency", "2"}, {"PG_index_us", "200"}},	true,	false,	false},
+	{"shared",	2, {{"PG_proj_shared", "1"}},								true,	false,	false},
+	{"knn",		1, {{"PG_knn", "8"}},										true,	true,	false},
+	{"resume",	1, {{"PG_resume_dist", "1000000"}},							true,	false,	false},
+	{"augment",	2, {{"PG_augment", "64"}},									true,	false,	true},
+};
+
+static const int c_groupsMax = 64;
+static const int c_period = 240;	// frames of a sweep of the targets
+
+struct Pipe
+{
+	std::wstring dir;						// of the conf
+	std::vector<std::wstring> nameTargets;
+	MotionPipe* mopipe;
+	std::vector<HBODY> targets;
+	std::vector<_TRANSFORM> rests;			// [i_target], the rest l2w
+	std::vector<Real> reaches;				// [i_target]
+};
+
+static std::wstring Widen(const std::string& str)
+{
+	std::wstring_convert<std::codecvt_utf8_utf16<wchar_t>> converter;
+	return converter.from_bytes(str);
+}
+
+// the skeleton of the destination is read from the bvh file of the same name
+static HBODY __stdcall InitBody_Dst(void* paramProc
+								, const wchar_t* filePath
+								, const wchar_t* namesOnPair[]
+								, int n_pairs
+								, const B_Scale scales[]
+								, int n_scales
+								, const wchar_t* nameTargets[]
+								, int n_targets)
+{
+	Pipe* pipe = (Pipe*)paramProc;
+	for (int i_target = 0; i_target < n_targets; i_target ++)
+		pipe->nameTargets.push_back(nameTargets[i_target]);
+
+	std::wstring path(filePath);
+	std::size_t i_ext = path.find_last_of(L'.');
+	if (std::wstring::npos != i_ext)
+		path.erase(i_ext);
+	path = pipe->dir + path + L".bvh";
+
+	HBODY body_dst = H_INVALID;
+	HBVH bvh = load_bvh_w(path.c_str());
+	if (VALID_HANDLE(bvh))
+	{
+		HBODY body_bvh = create_tree_body_bvh(bvh);
+		if (VALID_HANDLE(body_bvh))
+		{
+			if (!clone_body_fbx(body_bvh, &body_dst))
+				body_dst = H_INVALID;
+			destroy_tree_body(body_bvh);
+		}
+		unload_bvh(bvh);
+	}
+	if (!VALID_HANDLE(body_dst))
+		wprintf(L"%s is not loaded\n", path.c_str());
+	return body_dst;
+}
+
+static HBODY FindBody(HBODY body, const std::wstring& name)
+{
+	for (; VALID_HANDLE(body); body = get_next_sibling_body(body))
+	{
+		if (name == body_name_w(body))
+			return body;
+		HBODY found = FindBody(get_first_child_body(body), name);
+		if (VALID_HANDLE(found))
+			return found;
+	}
+	return H_INVALID;
+}
+
+// the PG_* attributes are set on the bodies with posture graphs
+static int OverrideAttrs(TiXmlElement* ele, const Case& c)
+{
+	int n_bodies = 0;
+	for (; NULL != ele; ele = ele->NextSiblingElement())
+	{
+		if (NULL != ele->Attribute("PG_dir"))
+		{
+			for (const auto& attr : c_attrsBase)
+				ele->SetAttribute(attr[0], attr[1]);
+			for (int i_attr = 0; i_attr < 4 && NULL != c.attrs[i_attr][0]; i_attr ++)
+				ele->SetAttribute(c.attrs[i_attr][0], c.attrs[i_attr][1]);
+			n_bodies ++;
+		}
+		n_bodies += OverrideAttrs(ele->FirstChildElement(), c);
+	}
+	return n_bodies;
+}
+
+static bool WriteConf(const std::string& confPath, const std::string& casePath, const Case& c)
+{
+	TiXmlDocument doc(confPath);
+	return (doc.LoadFile()
+		&& OverrideAttrs(doc.FirstChildElement(), c) > 0
+		&& doc.SaveFile(casePath));
+}
+
+static bool LoadPipe(const std::string& casePath, Pipe& pipe)
+{
+	std::wstring path = Widen(casePath);
+	std::size_t i_dir = path.find_last_of(L"/\\");
+	pipe.dir = (std::wstring::npos == i_dir) ? std::wstring() : path.substr(0, i_dir + 1);
+	pipe.mopipe = NULL;
+	FuncBodyInit onInitBody[2] = {NULL, InitBody_Dst};
+	if (!load_mopipe(&pipe.mopipe, path.c_str(), onInitBody, &pipe))
+		return false;
+
+	HBODY root = pipe.mopipe->bodies[1];
+	_TRANSFORM tm_root;
+	get_body_transform_l2w(root, &tm_root);
+	for (const auto& name : pipe.nameTargets)
+	{
+		HBODY target = FindBody(root, name);
+		if (!VALID_HANDLE(target))
+		{
+			wprintf(L"the target %s is not in the destination\n", name.c_str());
+			return false;
+		}
+		_TRANSFORM tm;
+		get_body_transform_l2w(target, &tm);
+		Real dx = tm.tt.x - tm_root.tt.x;
+		Real dy = tm.tt.y - tm_root.tt.y;
+		Real dz = tm.tt.z - tm_root.tt.z;
+		pipe.targets.push_back(target);
+		pipe.rests.push_back(tm);
+		pipe.reaches.push_back(sqrt(dx*dx + dy*dy + dz*dz));
+	}
+	return !pipe.targets.empty();
+}
+
+static void UpdatePipe(Pipe& pipe, int i_frame, Real reach)
+{
+	int n_targets = (int)pipe.targets.size();
+	for (int i_target = 0; i_target < n_targets; i_target ++)
+	{
+		Real phase = (Real)(2 * M_PI) * (Real)i_frame / (Real)c_period + (Real)i_target;
+		Real r = reach * pipe.reaches[i_target];
+		_TRANSFORM tm = pipe.rests[i_target];
+		tm.tt.x += r * cos(phase);
+		tm.tt.y += r * (Real)0.5 * sin(2 * phase);
+		tm.tt.z += r * sin(phase);
+		ik_task_update(pipe.targets[i_target], &tm);
+	}
+	ik_update(pipe.mopipe);
+}
+
+static void Stats(const std::vector<Pipe>& pipes, PG_Stats& stats)
+{
+	memset(&stats, 0, sizeof(PG_Stats));
+	PG_Stats stats_groups[c_groupsMax];
+	for (const auto& pipe : pipes)
+	{
+		int n_groups = std::min(c_groupsMax, ik_pg_stats(pipe.mopipe, stats_groups, c_groupsMax));
+		for (int i_group = 0; i_group < n_groups; i_group ++)
+		{
+			const PG_Stats& stats_i = stats_groups[i_group];
+			stats.n_searches += stats_i.n_searches;
+			stats.n_localMinima += stats_i.n_localMinima;
+			stats.n_restarts += stats_i.n_restarts;
+			stats.n_projections += stats_i.n_projections;
+			stats.n_overlayTaken += stats_i.n_overlayTaken;
+		}
+	}
+}
+
+static bool RunCase(const Case& c, const std::string& confPath, int n_warmup, int n_frames, Real reach)
+{
+	std::string casePath = confPath + ".ik_alloc_check.xml";
+	if (!WriteConf(confPath, casePath, c))
+	{
+		printf("%-8s the conf has no body with PG_dir\n", c.name);
+		return false;
+	}
+	std::vector<Pipe> pipes(c.n_pipes);
+	bool loaded = true;
+	for (auto& pipe : pipes)
+		loaded = LoadPipe(casePath, pipe) && loaded;
+	remove(casePath.c_str());
+
+	bool passed = false;
+	if (loaded)
+	{
+		PG_Stats stats;
+		for (int i_frame = 0; i_frame < n_warmup; i_frame ++)
+		{
+			for (auto& pipe : pipes)
+				UpdatePipe(pipe, i_frame, reach);
+		}
+		Stats(pipes, stats);
+
+		long n_news = 0, n_eigens = 0, n_growthAllocs = 0;
+		int n_growthFrames = 0;
+		const char* eigenExpr = NULL;
+		unsigned long long n_overlay = stats.n_overlayTaken;
+		Eigen::internal::set_is_malloc_allowed(false);
+		for (int i_frame = n_warmup; i_frame < n_warmup + n_frames; i_frame ++)
+		{
+			t_news = 0;
+			t_eigens = 0;
+			t_counting = true;
+			for (auto& pipe : pipes)
+				UpdatePipe(pipe, i_frame, reach);
+			t_counting = false;
+
+			// an update taking the grown overlay allocates for the adjacency of the overlay
+			Stats(pipes, stats);
+			if (stats.n_overlayTaken > n_overlay)
+			{
+				n_overlay = stats.n_overlayTaken;
+				n_growthFrames ++;
+				n_growthAllocs += t_news + t_eigens;
+			}
+			else
+			{
+				n_news += t_news;
+				n_eigens += t_eigens;
+				if (t_eigens > 0)
+					eigenExpr = t_eigenExpr;
+			}
+		}
+		Eigen::internal::set_is_malloc_allowed(true);
+
+		unsigned long long n_seeded = stats.n_restarts - stats.n_localMinima;
+		bool covered = (stats.n_searches > 0
+					&& (!c.proj || stats.n_projections > 0)
+					&& (!c.seeded || n_seeded > 0)
+					&& (!c.overlay || stats.n_overlayTaken > 0));
+		passed = (covered && 0 == n_news && 0 == n_eigens);
+		printf("%-8s %s: allocations %ld, eigen %ld; overlay growth frames %d, allocations %ld;"
+				" searches %llu, seeded restarts %llu, projections %llu, overlay %llu%s\n"
+			, c.name
+			, passed ? "passed" : "FAILED"
+			, n_news, n_eigens
+			, n_growthFrames, n_growthAllocs
+			, stats.n_searches, n_seeded, stats.n_projections, stats.n_overlayTaken
+			, covered ? "" : ", the paths of the case are not taken");
+		if (NULL != eigenExpr)
+			printf("\t%s\n", eigenExpr);
+	}
+	else
+		printf("%-8s the motion pipe is not loaded\n", c.name);
+
+	for (auto& pipe : pipes)
+		unload_mopipe(pipe.mopipe);
+	return passed;
+}
+
+int main(int argc, char* argv[])
+{
+	if (argc < 2)
+	{
+		printf("ik_alloc_check <conf.xml> [n_warmup=200] [n_frames=2000] [reach=0.5]\n");
+		return -1;
+	}
+	std::string confPath(argv[1]);
+	int n_warmup = (argc > 2) ? atoi(argv[2]) : 200;
+	int n_frames = (argc > 3) ? atoi(argv[3]) : 2000;
+	Real reach = (argc > 4) ? (Real)atof(argv[4]) : (Real)0.5;
+
+	int n_failed = 0;
+	for (const auto& c : c_cases)
+	{
+		if (!RunCase(c, confPath, n_warmup, n_frames, reach))
+			n_failed ++;
+	}
+	printf("%d of %d cases failed\n", n_failed, (int)(sizeof(c_cases) / sizeof(Case)));
+	return n_failed;
+}
@@ -0,0 +1,9 @@
+#pragma once
+// forced into every source of ik_alloc_check:
+//	a heap allocation of Eigen while it is not allowed is a failed eigen_assert, counted on the thread being checked
+#define EIGEN_RUNTIME_NO_MALLOC
+#ifdef __cplusplus
+extern "C"
+#endif
+void IKAllocCheck_EigenAssert(const char* expr);
+#define eigen_assert(x) ((x) ? (void)0 : IKAllocCheck_EigenAssert(#x))
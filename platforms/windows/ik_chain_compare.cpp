@@ -0,0 +1,174 @@
+// ik_chain_compare.cpp: the cost per solve and the convergence of the chain algorithms on the same goal stream
+//		ik_chain_compare [n_segs=3] [limited=0] [n_frames=20000]
+//	a chain of n_segs spherical segments of length c_lenBone is solved towards a goal sweeping through its reach,
+//	the goal jumps to a random position every 50 frames, the positions out of 95% of the reach are unreachable,
+//	limited puts the joint limits on the segments (C_Direct),
+//	a solve converges if the end effector ends within tol_p of the goal, DLS and SDLS are the references
+#include "pch.h"
+#include <chrono>
+#include <random>
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+#include "ArtiBody.hpp"
+#include "IKChainInverseJK.hpp"
+#include "IKChainGeometric.hpp"
+#include "IKChainTwoBone.hpp"
+
+HMODULE g_Module = NULL;
+
+static const Real c_lenBone = 30;
+static const Real c_tolP = 1;
+static const int c_nIters = 20;
+
+struct Rig
+{
+	std::vector<CArtiBodyNode*> bodies;
+	CArtiBodyNode* target;
+	CIKChain* chain;
+};
+
+static CIKChain* CreateChain(const char* algor)
+{
+	const Real pole[3] = {0, 0, 0};
+	if (0 == strcmp(algor, "DLS"))
+		return new CIKChainInverseJK_DLS(1, 0, c_nIters, c_tolP, 15);
+	else if (0 == strcmp(algor, "SDLS"))
+		return new CIKChainInverseJK_SDLS(1, 0, c_nIters, c_tolP, 15);
+	else if (0 == strcmp(algor, "NDLS"))
+		return new CIKChainInverseJK_NDLS(1, 0, c_nIters, c_tolP, 15);
+	else if (0 == strcmp(algor, "JT"))
+		return new CIKChainInverseJK_JT(1, 0, c_nIters, c_tolP, 15);
+	else if (0 == strcmp(algor, "CCD"))
+		return new CIKChainCCD(1, 0, c_nIters, c_tolP, 15);
+	else if (0 == strcmp(algor, "FABRIK"))
+		return new CIKChainFABRIK(1, 0, c_nIters, c_tolP, 15);
+	else if (0 == strcmp(algor, "TwoBone"))
+		return new CIKChainTwoBone(1, 0, c_nIters, c_tolP, 15, pole);
+	else
+		return NULL;
+}
+
+static bool BuildRig(Rig& rig, int n_segs, bool limited, CIKChain* chain)
+{
+	for (int i_seg = 0; i_seg <= n_segs; i_seg ++)
+	{
+		_TRANSFORM tm = { {1, 1, 1}, {1, 0, 0, 0}, {0, (i_seg > 0 ? c_lenBone : 0), 0} };
+		char name[16];
+		sprintf(name, "b%d", i_seg);
+		CArtiBodyNode* body = CArtiBodyTree::CreateSimNode(name, &tm, bvh, i_seg > 0 ? t_r : t_tr);
+		if (i_seg > 0)
+			Tree<CArtiBodyNode>::Connect(rig.bodies.back(), body, FIRSTCHD);
+		rig.bodies.push_back(body);
+	}
+	CArtiBodyTree::KINA_Initialize(rig.bodies[0]);
+	// a slight bend keeps the chain off the singularity at the start
+	for (int i_seg = 0; i_seg < n_segs; i_seg ++)
+		rig.bodies[i_seg]->GetJoint()->SetRotation(Eigen::Quaternionr(Eigen::AngleAxisr((Real)0.3, Eigen::Vector3r::UnitX())));
+	CArtiBodyTree::FK_Update<true>(rig.bodies[0]);
+
+	_TRANSFORM tm_t = { {1, 1, 1}, {1, 0, 0, 0}, {0, 0, 0} };
+	rig.target = CArtiBodyTree::CreateSimNode("t", &tm_t, bvh, t_tr);
+	CArtiBodyTree::KINA_Initialize(rig.target);
+	CArtiBodyTree::FK_Update<false>(rig.target);
+
+	std::vector<CONF::CJointConf> confs;
+	const Real dex[3] = {1, 1, 1};
+	for (int i_seg = 0; i_seg < n_segs; i_seg ++)
+	{
+		char name[16];
+		sprintf(name, "b%d", i_seg);
+		CONF::CJointConf conf(name, IK_QSegment::R_Spherical, dex, limited ? IK_QSegment::C_Direct : IK_QSegment::C_None);
+		if (limited)
+		{
+			const Real lim[3][2] = { {-1.2f, 1.2f}, {-0.8f, 0.8f}, {-1.2f, 1.2f} };
+			memcpy(conf.lim, lim, sizeof(lim));
+		}
+		confs.push_back(conf);
+	}
+	rig.chain = chain;
+	if (!chain->Init(rig.bodies[n_segs], n_segs, confs))
+		return false;
+	chain->SetGRoot(rig.bodies[0]);
+	std::map<std::wstring, CArtiBodyNode*> targets;
+	targets[rig.bodies[n_segs]->GetName_w()] = rig.target;
+	chain->SetupTarget(targets, Eigen::Matrix3r::Identity(), Eigen::Matrix3r::Identity());
+	return true;
+}
+
+static void DestroyRig(Rig& rig)
+{
+	delete rig.chain;
+	CArtiBodyTree::Destroy(rig.bodies[0]);
+	CArtiBodyTree::Destroy(rig.target);
+	rig.bodies.clear();
+}
+
+int main(int argc, char** argv)
+{
+	int n_segs = (argc > 1 ? atoi(argv[1]) : 3);
+	bool limited = (argc > 2 ? (0 != atoi(argv[2])) : false);
+	int n_frames = (argc > 3 ? atoi(argv[3]) : 20000);
+	if (n_segs < 1 || n_frames < 1)
+	{
+		printf("usage: ik_chain_compare [n_segs=3] [limited=0] [n_frames=20000]\n");
+		return -1;
+	}
+	const char* algors[] = {"DLS", "SDLS", "NDLS", "JT", "CCD", "FABRIK", "TwoBone"};
+	const Real reach = n_segs * c_lenBone;
+	printf("segments %d, limited %d, frames %d, tol_p %g, bone %g\n", n_segs, limited, n_frames, c_tolP, c_lenBone);
+	int n_fails = 0;
+	for (const char* algor : algors)
+	{
+		if (0 == strcmp(algor, "TwoBone") && 2 != n_segs)
+			continue;
+		Rig rig;
+		if (!BuildRig(rig, n_segs, limited, CreateChain(algor)))
+		{
+			printf("%-8s init failed\n", algor);
+			DestroyRig(rig);
+			n_fails ++;
+			continue;
+		}
+		std::mt19937 gen(7);
+		std::uniform_real_distribution<float> uni(-1, 1);
+		Transform_TR w2g;
+		double us_sum = 0, err_sum = 0;
+		int n_converged = 0, n_reachable = 0, n_converged_reachable = 0;
+		for (int i_frame = 0; i_frame < n_frames; i_frame ++)
+		{
+			Real t = i_frame * 0.01f;
+			Eigen::Vector3r goal((Real)(0.5*sin(t)), (Real)(0.5 + 0.35*cos(0.7*t)), (Real)(0.4*sin(1.3*t)));
+			if (0 == i_frame % 50)
+				goal = Eigen::Vector3r(uni(gen), uni(gen), uni(gen)) * (Real)0.6;
+			goal *= reach;
+			_TRANSFORM tm_t = { {1, 1, 1}, {1, 0, 0, 0}, {goal.x(), goal.y(), goal.z()} };
+			rig.target->UpdateGoal(tm_t);
+
+			auto tick_0 = std::chrono::high_resolution_clock::now();
+			if (rig.chain->BeginUpdate(w2g))
+			{
+				rig.chain->Update();
+				rig.chain->EndUpdate();
+			}
+			auto tick_1 = std::chrono::high_resolution_clock::now();
+			us_sum += std::chrono::duration<double, std::micro>(tick_1 - tick_0).count();
+
+			Real err = sqrt(rig.chain->Error());
+			bool reachable = (goal.norm() < reach * (Real)0.95);
+			bool converged = (err < c_tolP);
+			err_sum += err;
+			n_reachable += reachable;
+			n_converged += converged;
+			n_converged_reachable += (reachable && converged);
+		}
+		printf("%-8s %8.2f us/solve  converged %6.2f%%  (reachable %6.2f%%)  mean err %7.3f\n"
+			, algor
+			, us_sum / n_frames
+			, 100.0 * n_converged / n_frames
+			, 100.0 * n_converged_reachable / std::max(1, n_reachable)
+			, err_sum / n_frames);
+		DestroyRig(rig);
+	}
+	return n_fails;
+}
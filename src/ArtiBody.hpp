@@ -476,32 +476,47 @@ START_PROFILER_AUTOFRAME(root->GetName_c(), 1)
 STOP_PROFILER
 	}
 
+	// the FK of a single body on the cached transform of its parent:
+	//	the bodies of a path are updated from the top down, the bodies off the path are not
+	template<bool G_ROOT>
+	static void FK_UpdateNode(CArtiBodyNode* body)
+	{
+		if (body->c_type&anim)
+			static_cast<CArtiBodyNode_anim*>(body)->FK_UpdateNode<G_ROOT>();
+		else
+		{
+			switch (body->c_jtmflag)
+			{
+				case t_r:
+					static_cast<CArtiBodyNode_sim_r*>(body)->FK_UpdateNode<G_ROOT>();
+					break;
+				case t_tr:
+					static_cast<CArtiBodyNode_sim_tr*>(body)->FK_UpdateNode<G_ROOT>();
+					break;
+			}
+		}
+	}
+
+	// the transforms are archived in the DFS order of m_kinalst,
+	//	the archive is resized only for a different tree, so a steady serialization allocates nothing
 	template<bool IS_SAVE>
 	static void Serialize(CArtiBodyNode* root, TransformArchive& tms)
 	{
-		if (IS_SAVE)
-			tms.Resize((int)root->m_kinalst.size());
-		
-		int i_tm = 0;
-		auto onEnterBody = [&i_tm, &tms](CArtiBodyNode* body)
-			{
-				_TRANSFORM& tm_i = tms[i_tm ++];
-				if (IS_SAVE)
-				{
-					Transform* tm_joint_i = body->GetJoint()->GetTransform();
-					tm_joint_i->CopyTo(tm_i);
-				}
-				else // is restore
-				{
-					Transform* tm_joint_i = body->GetJoint()->GetTransform();
-					tm_joint_i->CopyFrom(tm_i);
-				}
-			};
-		auto onLeaveBody = [](CArtiBodyNode* body)
-			{
+		int n_tms = (int)root->m_kinalst.size();
+		if (IS_SAVE
+			&& n_tms != (int)tms.Size())
+			tms.Resize(n_tms);
 
-			};
-		CArtiBodyTree::TraverseDFS(root, onEnterBody, onLeaveBody);
+		int i_tm = 0;
+		for (auto body : root->m_kinalst)
+		{
+			_TRANSFORM& tm_i = tms[i_tm ++];
+			Transform* tm_joint_i = body->GetJoint()->GetTransform();
+			if (IS_SAVE)
+				tm_joint_i->CopyTo(tm_i);
+			else // is restore
+				tm_joint_i->CopyFrom(tm_i);
+		}
 	}
 
 	static void Destroy(CArtiBodyNode* node);
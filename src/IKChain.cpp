@@ -6,6 +6,11 @@ BEGIN_ENUM_STR(CIKChain, Algor)
 	ENUM_ITEM(Proj)
 	ENUM_ITEM(DLS)
 	ENUM_ITEM(SDLS)
+	ENUM_ITEM(NDLS)
+	ENUM_ITEM(TwoBone)
+	ENUM_ITEM(CCD)
+	ENUM_ITEM(FABRIK)
+	ENUM_ITEM(JT)
 	ENUM_ITEM(Unknown)
 END_ENUM_STR(CIKChain, Algor)
 
@@ -16,7 +16,12 @@ public:
 		Proj = 0x00000001,
 		DLS = 0x00000002,
 		SDLS = 0x00000004,
-		NUM = 0x00000006,
+		NDLS = 0x00000008,		// DLS by the normal equations
+		TwoBone = 0x00000010,	// analytic for 2 segments, DLS for the limits
+		CCD = 0x00000020,
+		FABRIK = 0x00000040,
+		JT = 0x00000080,		// jacobian transpose
+		NUM = 0x000000FE,
 		Unknown,
 	};
 
@@ -32,6 +37,10 @@ public:
 	virtual ~CIKChain();
 	virtual bool Init(const CArtiBodyNode* eef, int len, const std::vector<CONF::CJointConf>& joint_confs);
 	virtual Real Error() const = 0;
+	// the error with the end effector at eef_g in the group space, the body is not touched
+	virtual Real Error(const _TRANSFORM& eef_g) const = 0;
+	// the position goal of the end effector in the group space, false if the error does not take a position
+	virtual bool Goal_t(Real tt_g[3]) const = 0;
 
 	void SetupTarget(const std::map<std::wstring, CArtiBodyNode*>& nameSrc2bodyDst
 					, const Eigen::Matrix3r& src2dst_w
@@ -60,6 +69,11 @@ public:
 		return (int)m_nodes.size();
 	}
 
+	CArtiBodyNode* EndEffector() const
+	{
+		return m_eefSrc;
+	}
+
 	bool operator < (const CIKChain& other)
 	{
 		int n_dist2root_this = 0;
@@ -117,6 +131,16 @@ public:
 		return (Real)0;
 	}
 
+	virtual Real Error(const _TRANSFORM&) const
+	{
+		return (Real)0;
+	}
+
+	virtual bool Goal_t(Real[3]) const
+	{
+		return false;
+	}
+
 	virtual void Dump(std::ostream& info) const override;
 	// this is a quick IK update solution
 	virtual bool Update();
@@ -138,6 +162,16 @@ public:
 		return (Real)0;
 	}
 
+	virtual Real Error(const _TRANSFORM&) const
+	{
+		return (Real)0;
+	}
+
+	virtual bool Goal_t(Real[3]) const
+	{
+		return false;
+	}
+
 	virtual void Dump(std::ostream& info) const override;
 	virtual bool BeginUpdate(const Transform_TR& w2g) override;
 	// this is a quick IK update solution
@@ -0,0 +1,217 @@
+#include "pch.h"
+#include "Math.hpp"
+#include "IKChainGeometric.hpp"
+
+CIKChainGeometric::CIKChainGeometric(CIKChain::Algor algor, Real weight_p, Real weight_r, int n_iter, Real tol_p, Real tol_r)
+	: Super(algor, n_iter, weight_p, weight_r)
+	, m_taskP(true, m_eefSrc, tol_p)
+	, m_taskR(true, m_eefSrc, tol_r)
+{
+	m_goalT.setZero();
+	m_goalR.setIdentity();
+}
+
+CIKChainGeometric::~CIKChainGeometric()
+{
+}
+
+bool CIKChainGeometric::Init(const CArtiBodyNode* eef, int len, const std::vector<CONF::CJointConf>& joint_confs)
+{
+	if (!Super::Init(eef, len, joint_confs))
+		return false;
+	m_taskP.SetSegment(m_segments);
+	m_taskR.SetSegment(m_segments);
+	return true;
+}
+
+void CIKChainGeometric::Dump(std::ostream& info) const
+{
+	info << from_Algor(c_algor) << " : ";
+	Super::Dump(info);
+}
+
+bool CIKChainGeometric::BeginUpdate(const Transform_TR& w2g)
+{
+	if (!Super::BeginUpdate(w2g))
+		return false;
+	_TRANSFORM goal;
+	m_eefSrc->GetGoal(goal);
+	IKAssert(NoScale(goal));
+
+	m_goalT = Eigen::Vector3r(goal.tt.x, goal.tt.y, goal.tt.z);
+	m_goalR = Eigen::Quaternionr(goal.r.w, goal.r.x, goal.r.y, goal.r.z);
+
+	m_taskP.SetGoal(m_goalT);
+	m_taskR.SetGoal(m_goalR);
+	return true;
+}
+
+bool CIKChainGeometric::Update()
+{
+	const Real sigma_d_alpha_sqr_min = (Real)0.0000761544202225; // deg2rad(0.5)^2
+	bool updating = (c_taskW_t > 0);
+	int i_iter = 0;
+	for (
+		; i_iter < m_nIters
+			&& updating
+			&& !m_taskP.Completed()
+		; i_iter ++)
+	{
+		Real sigma_d_alpha_sqr = UpdateIteration();
+		LOGIKVarNJK(LogInfoReal, sigma_d_alpha_sqr);
+		updating = (sigma_d_alpha_sqr_min < sigma_d_alpha_sqr);
+	}
+
+	if (c_taskW_r > 0)
+	{
+		m_eefSrc->GetJoint()->SetRotation_w(m_goalR);
+		FK_UpdateSubtree(m_eefSrc);
+	}
+
+	bool solved = UpdateCompleted();
+	LOGIKVarNJK(LogInfoBool, solved);
+	LOGIKVarNJK(LogInfoInt, i_iter);
+	return solved;
+}
+
+bool CIKChainGeometric::UpdateCompleted() const
+{
+	return (!(c_taskW_t > 0) || m_taskP.Completed())
+		&& (!(c_taskW_r > 0) || m_taskR.Completed());
+}
+
+void CIKChainGeometric::EndUpdate()
+{
+	m_taskP.End();
+	m_taskR.End();
+}
+
+Real CIKChainGeometric::Rotate(IK_QSegment* seg, const Eigen::Quaternionr& R)
+{
+	CArtiBodyNode* body = seg->GetBody();
+	Eigen::Quaternionr Q = Transform::getRotation_q(body->GetTransformLocal2World());
+	// normalized, or the rotation drifts through the world rotation of the parent
+	body->GetJoint()->SetRotation_w((R * Q).normalized());
+	bool clamped = seg->Clamp();
+	LOGIKVarNJK(LogInfoBool, clamped);
+	FK_UpdateSubtree(body);
+	// the rotation after the clamp, a segment held by its limits does not keep the iterations going
+	Real d_alpha = Q.angularDistance(Transform::getRotation_q(body->GetTransformLocal2World()));
+	return d_alpha * d_alpha;
+}
+
+void CIKChainGeometric::FK_UpdateSubtree(CArtiBodyNode* body)
+{
+	// the parent of a body under the group root is in the group space
+	if (m_rootG == body)
+		CArtiBodyTree::FK_Update<true>(body);
+	else
+		CArtiBodyTree::FK_Update<false>(body);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// CIKChainCCD:
+
+CIKChainCCD::CIKChainCCD(Real weight_p, Real weight_r, int n_iter, Real tol_p, Real tol_r)
+	: CIKChainGeometric(CIKChain::CCD, weight_p, weight_r, n_iter, tol_p, tol_r)
+{
+}
+
+CIKChainCCD::~CIKChainCCD()
+{
+}
+
+Real CIKChainCCD::UpdateIteration()
+{
+	Real sigma_d_alpha_sqr = 0;
+	auto it_seg = m_segments.end();
+	while (it_seg != m_segments.begin())
+	{
+		it_seg --;
+		auto seg = *it_seg;
+		Eigen::Vector3r p_i = seg->GlobalStart();
+		Eigen::Vector3r pi_eef = EndEffector_t() - p_i;
+		Eigen::Vector3r pi_t = m_goalT - p_i;
+		if (pi_eef.norm() > c_epsilonsqrt
+			&& pi_t.norm() > c_epsilonsqrt)
+		{
+			Eigen::Quaternionr R = Eigen::Quaternionr::FromTwoVectors(pi_eef, pi_t);
+			R = Eigen::Quaternionr::Identity().slerp((Real)1 - seg->Stiffness(), R);
+			sigma_d_alpha_sqr += Rotate(seg, R);
+		}
+	}
+	return sigma_d_alpha_sqr;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// CIKChainFABRIK:
+
+CIKChainFABRIK::CIKChainFABRIK(Real weight_p, Real weight_r, int n_iter, Real tol_p, Real tol_r)
+	: CIKChainGeometric(CIKChain::FABRIK, weight_p, weight_r, n_iter, tol_p, tol_r)
+{
+}
+
+CIKChainFABRIK::~CIKChainFABRIK()
+{
+}
+
+bool CIKChainFABRIK::Init(const CArtiBodyNode* eef, int len, const std::vector<CONF::CJointConf>& joint_confs)
+{
+	if (!Super::Init(eef, len, joint_confs))
+		return false;
+	int n_segs = (int)m_segments.size();
+	m_p.resize(n_segs + 1);
+	m_len.resize(n_segs);
+	return true;
+}
+
+Real CIKChainFABRIK::UpdateIteration()
+{
+	int n_segs = (int)m_segments.size();
+	for (int i_seg = 0; i_seg < n_segs; i_seg ++)
+		m_p[i_seg] = m_segments[i_seg]->GlobalStart();
+	m_p[n_segs] = EndEffector_t();
+	for (int i_seg = 0; i_seg < n_segs; i_seg ++)
+		m_len[i_seg] = (m_p[i_seg + 1] - m_p[i_seg]).norm();
+
+	// forward: reaching from the goal
+	Eigen::Vector3r p_0 = m_p[0];
+	m_p[n_segs] = m_goalT;
+	for (int i_seg = n_segs - 1; i_seg >= 0; i_seg --)
+	{
+		Eigen::Vector3r d = m_p[i_seg] - m_p[i_seg + 1];
+		Real d_norm = d.norm();
+		if (d_norm > c_epsilon)
+			m_p[i_seg] = m_p[i_seg + 1] + (m_len[i_seg] / d_norm) * d;
+	}
+
+	// backward: reaching from the root
+	m_p[0] = p_0;
+	for (int i_seg = 0; i_seg < n_segs; i_seg ++)
+	{
+		Eigen::Vector3r d = m_p[i_seg + 1] - m_p[i_seg];
+		Real d_norm = d.norm();
+		if (d_norm > c_epsilon)
+			m_p[i_seg + 1] = m_p[i_seg] + (m_len[i_seg] / d_norm) * d;
+	}
+
+	// the segments are swung from their clamped starts on to the reached positions
+	Real sigma_d_alpha_sqr = 0;
+	for (int i_seg = 0; i_seg < n_segs; i_seg ++)
+	{
+		auto seg = m_segments[i_seg];
+		Eigen::Vector3r p_i = seg->GlobalStart();
+		Eigen::Vector3r p_i_next = (i_seg + 1 < n_segs)
+								? m_segments[i_seg + 1]->GlobalStart()
+								: EndEffector_t();
+		Eigen::Vector3r pi_next = p_i_next - p_i;
+		Eigen::Vector3r pi_t = m_p[i_seg + 1] - p_i;
+		if (pi_next.norm() > c_epsilonsqrt
+			&& pi_t.norm() > c_epsilonsqrt)
+		{
+			Eigen::Quaternionr R = Eigen::Quaternionr::FromTwoVectors(pi_next, pi_t);
+			sigma_d_alpha_sqr += Rotate(seg, R);
+		}
+	}
+	return sigma_d_alpha_sqr;
+}
@@ -0,0 +1,66 @@
+#pragma once
+#include "IKChainNumerical.hpp"
+#include "IK_QTask.h"
+
+// the chains solved on the joint positions instead of a jacobian:
+//	an iteration rotates the segments in the group space, each rotated joint is clamped into its limits,
+//	the end effector is rotated to the goal for an orientation task.
+//	the tasks and the convergence are the ones of IKChainInverseJK
+class CIKChainGeometric : public CIKChainNumerical
+{
+	typedef CIKChainNumerical Super;
+public:
+	CIKChainGeometric(CIKChain::Algor algor, Real weight_p, Real weight_r, int n_iter, Real tol_p, Real tol_r);
+	virtual ~CIKChainGeometric();
+	virtual bool Init(const CArtiBodyNode* eef, int len, const std::vector<CONF::CJointConf>& joint_confs) override;
+	virtual void Dump(std::ostream& info) const override;
+	virtual bool BeginUpdate(const Transform_TR& w2g) override;
+	virtual bool Update() override;
+	virtual bool UpdateCompleted() const override;
+	virtual void EndUpdate() override;
+protected:
+	// an iteration towards m_goalT, returns the sum of the squared rotation angles of the segments
+	virtual Real UpdateIteration() = 0;
+	// the body of the segment is rotated by R in the group space and clamped, the bodies after it are updated,
+	//	returns the squared angle the body is rotated by
+	Real Rotate(IK_QSegment* seg, const Eigen::Quaternionr& R);
+	void FK_UpdateSubtree(CArtiBodyNode* body);
+	Eigen::Vector3r EndEffector_t() const
+	{
+		return m_eefSrc->GetTransformLocal2World()->getTranslation();
+	}
+protected:
+	Eigen::Vector3r m_goalT;
+	Eigen::Quaternionr m_goalR;
+private:
+	IK_QPositionTask m_taskP;
+	IK_QOrientationTask m_taskR;
+};
+
+// cyclic coordinate descent: from the end effector to the root,
+//	a segment swings the end effector towards the goal, damped by the stiffness of the segment
+class CIKChainCCD : public CIKChainGeometric
+{
+public:
+	CIKChainCCD(Real weight_p, Real weight_r, int n_iter, Real tol_p, Real tol_r);
+	virtual ~CIKChainCCD();
+protected:
+	virtual Real UpdateIteration() override;
+};
+
+// forward and backward reaching: the joint positions are reached from the goal and then from the root,
+//	the segments are swung from the root on to the reached positions, so the next iteration
+//	reaches from the positions reprojected by the joint limits
+class CIKChainFABRIK : public CIKChainGeometric
+{
+	typedef CIKChainGeometric Super;
+public:
+	CIKChainFABRIK(Real weight_p, Real weight_r, int n_iter, Real tol_p, Real tol_r);
+	virtual ~CIKChainFABRIK();
+	virtual bool Init(const CArtiBodyNode* eef, int len, const std::vector<CONF::CJointConf>& joint_confs) override;
+protected:
+	virtual Real UpdateIteration() override;
+private:
+	std::vector<Eigen::Vector3r> m_p;	// [i_seg]: the start of a segment, [n_segs]: the end effector
+	std::vector<Real> m_len;			// [i_seg]
+};
@@ -13,6 +13,18 @@ CIKChainInverseJK_DLS::~CIKChainInverseJK_DLS()
 }
 
 
+CIKChainInverseJK_NDLS::CIKChainInverseJK_NDLS(Real weight_p, Real weight_r, int n_iter, Real tol_p, Real tol_r)
+	: IKChainInverseJK<IK_QJacobianNDLS>(CIKChain::NDLS, weight_p, weight_r, n_iter, tol_p, tol_r)
+{
+
+}
+
+CIKChainInverseJK_NDLS::~CIKChainInverseJK_NDLS()
+{
+
+}
+
+
 CIKChainInverseJK_SDLS::CIKChainInverseJK_SDLS(Real weight_p, Real weight_r, int n_iter, Real tol_p, Real tol_r)
 	: IKChainInverseJK<IK_QJacobianSDLS>(CIKChain::SDLS, weight_p, weight_r, n_iter, tol_p, tol_r)
 {
@@ -22,4 +34,16 @@ CIKChainInverseJK_SDLS::CIKChainInverseJK_SDLS(Real weight_p, Real weight_r, int
 CIKChainInverseJK_SDLS::~CIKChainInverseJK_SDLS()
 {
 
+}
+
+
+CIKChainInverseJK_JT::CIKChainInverseJK_JT(Real weight_p, Real weight_r, int n_iter, Real tol_p, Real tol_r)
+	: IKChainInverseJK<IK_QJacobianJT>(CIKChain::JT, weight_p, weight_r, n_iter, tol_p, tol_r)
+{
+
+}
+
+CIKChainInverseJK_JT::~CIKChainInverseJK_JT()
+{
+
 }
\ No newline at end of file
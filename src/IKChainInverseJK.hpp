@@ -1,3 +1,4 @@
+#pragma once
 #include "IKChainNumerical.hpp"
 #include "IK_QJacobian.h"
 #include "IK_QTask.h"
@@ -183,6 +184,7 @@ public:
 			{
 				const char* err = "IK Exception\n";
 				LOGIKVarErr(LogInfoCharPtr, err);
+				CArtiBodyTree::FK_Update<true>(m_rootG);
 				return false;
 			}
 			// update angles and check limits
@@ -195,9 +197,11 @@ public:
 
 			updating = (sigma_d_alpha_sqr_min < sigma_d_alpha_sqr);
 			if (updating)
-				CArtiBodyTree::FK_Update<true>(m_rootG);
+				FK_UpdateChain();		// the jacobian and the error only see the chain and the end effector
 
 		}
+		// the bodies off the chain catch up once, the same as updating the group on every iteration
+		CArtiBodyTree::FK_Update<true>(m_rootG);
 
 		for (auto seg : m_segments)
 			seg->UnLock();
@@ -325,9 +329,23 @@ public:
 	virtual ~CIKChainInverseJK_DLS();
 };
 
+class CIKChainInverseJK_NDLS : public IKChainInverseJK<IK_QJacobianNDLS>
+{
+public:
+	CIKChainInverseJK_NDLS(Real weight_p, Real weight_r, int n_iter, Real tol_p, Real tol_r);
+	virtual ~CIKChainInverseJK_NDLS();
+};
+
 class CIKChainInverseJK_SDLS : public IKChainInverseJK<IK_QJacobianSDLS>
 {
 public:
 	CIKChainInverseJK_SDLS(Real weight_p, Real weight_r, int n_iter, Real tol_p, Real tol_r);
 	virtual ~CIKChainInverseJK_SDLS();
 };
+
+class CIKChainInverseJK_JT : public IKChainInverseJK<IK_QJacobianJT>
+{
+public:
+	CIKChainInverseJK_JT(Real weight_p, Real weight_r, int n_iter, Real tol_p, Real tol_r);
+	virtual ~CIKChainInverseJK_JT();
+};
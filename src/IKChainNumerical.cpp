@@ -109,6 +109,21 @@ bool CIKChainNumerical::Init(const CArtiBodyNode* eef, int len, const std::vecto
 	return n_segs > 0;
 }
 
+void CIKChainNumerical::FK_UpdateChain()
+{
+	IKAssert(!m_nodes.empty());
+	// the parent of a body under the group root is in the group space
+	CArtiBodyNode* body_0 = m_nodes[0].body;
+	if (m_rootG == body_0)
+		CArtiBodyTree::FK_UpdateNode<true>(body_0);
+	else
+		CArtiBodyTree::FK_UpdateNode<false>(body_0);
+	int n_nodes = (int)m_nodes.size();
+	for (int i_node = 1; i_node < n_nodes; i_node ++)
+		CArtiBodyTree::FK_UpdateNode<false>(m_nodes[i_node].body);
+	CArtiBodyTree::FK_UpdateNode<false>(m_eefSrc);
+}
+
 // posture graph IK only cares position
 Real CIKChainNumerical::Error() const
 {
@@ -122,6 +137,26 @@ Real CIKChainNumerical::Error() const
 	return dx*dx + dy*dy + dz*dz;
 }
 
+Real CIKChainNumerical::Error(const _TRANSFORM& eef_g) const
+{
+	_TRANSFORM tm_t;
+	m_eefSrc->GetGoal(tm_t);
+	Real dx = tm_t.tt.x - eef_g.tt.x;
+	Real dy = tm_t.tt.y - eef_g.tt.y;
+	Real dz = tm_t.tt.z - eef_g.tt.z;
+	return dx*dx + dy*dy + dz*dz;
+}
+
+bool CIKChainNumerical::Goal_t(Real tt_g[3]) const
+{
+	_TRANSFORM tm_t;
+	m_eefSrc->GetGoal(tm_t);
+	tt_g[0] = tm_t.tt.x;
+	tt_g[1] = tm_t.tt.y;
+	tt_g[2] = tm_t.tt.z;
+	return true;
+}
+
 Real CIKChainNumerical::ErrorCCD() const
 {
 	_TRANSFORM tm_t;
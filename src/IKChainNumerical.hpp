@@ -1,3 +1,4 @@
+#pragma once
 #include "IKChain.hpp"
 #include "IK_QSegment.hpp"
 
@@ -20,8 +21,13 @@ public:
 	virtual bool Init(const CArtiBodyNode* eef, int len, const std::vector<CONF::CJointConf>& joint_confs) override;
 	virtual bool Update() = 0;
 	virtual Real Error() const;
+	virtual Real Error(const _TRANSFORM& eef_g) const;
+	virtual bool Goal_t(Real tt_g[3]) const;
 protected:
 	Real ErrorCCD() const;
+	// the FK of the chain bodies and the end effector only, for the iterations that change no other joint:
+	//	the bodies branching off the chain are left behind until FK_Update of the group root
+	void FK_UpdateChain();
 	std::vector<IK_QSegment*> m_segments; //the corresponds to CIKChain::m_segments
 	const Real c_taskW_r, c_taskW_t;
 };
\ No newline at end of file
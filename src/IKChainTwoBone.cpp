@@ -0,0 +1,123 @@
+#include "pch.h"
+#include "Math.hpp"
+#include "IKChainTwoBone.hpp"
+
+CIKChainTwoBone::CIKChainTwoBone(Real weight_p, Real weight_r, int n_iter, Real tol_p, Real tol_r, const Real pole[3])
+	: Super(CIKChain::TwoBone, weight_p, weight_r, n_iter, tol_p, tol_r)
+	, m_poleW(pole[0], pole[1], pole[2])
+{
+	m_poled = !FuzzyZero(m_poleW.norm());
+	if (m_poled)
+		m_poleW.normalize();
+	m_poleG = m_poleW;
+	m_bendG.setZero();
+	m_goalT.setZero();
+	m_goalR.setIdentity();
+}
+
+CIKChainTwoBone::~CIKChainTwoBone()
+{
+}
+
+bool CIKChainTwoBone::Init(const CArtiBodyNode* eef, int len, const std::vector<CONF::CJointConf>& joint_confs)
+{
+	if (!Super::Init(eef, len, joint_confs))
+		return false;
+	bool two_bones = (2 == m_nodes.size()
+					&& 2 == m_segments.size());
+	if (!two_bones)
+	{
+		LOGIKVarErr(LogInfoCharPtr, eef->GetName_c());
+		LOGIKVarErr(LogInfoInt, len);
+	}
+	return two_bones;
+}
+
+bool CIKChainTwoBone::BeginUpdate(const Transform_TR& w2g)
+{
+	if (!Super::BeginUpdate(w2g))
+		return false;
+	_TRANSFORM goal;
+	m_eefSrc->GetGoal(goal);
+	m_goalT = Eigen::Vector3r(goal.tt.x, goal.tt.y, goal.tt.z);
+	m_goalR = Eigen::Quaternionr(goal.r.w, goal.r.x, goal.r.y, goal.r.z);
+	if (m_poled)
+		m_poleG = w2g.Apply_v(m_poleW);
+	return true;
+}
+
+Eigen::Vector3r CIKChainTwoBone::BendDir(const Eigen::Vector3r& d, const Eigen::Vector3r& elbow) const
+{
+	const Eigen::Vector3r* dirs[] = {
+		m_poled ? &m_poleG : NULL,
+		&elbow,
+		&m_bendG
+	};
+	for (auto dir : dirs)
+	{
+		if (NULL == dir)
+			continue;
+		Eigen::Vector3r u = *dir - dir->dot(d) * d;
+		Real u_norm = u.norm();
+		if (u_norm > c_epsilonsqrt * dir->norm())
+			return u / u_norm;
+	}
+	return d.unitOrthogonal();
+}
+
+bool CIKChainTwoBone::Update()
+{
+	IK_QSegment* seg_0 = m_segments[0];
+	IK_QSegment* seg_1 = m_segments[1];
+	Eigen::Vector3r p_0 = seg_0->GlobalStart();
+	Eigen::Vector3r p_1 = seg_1->GlobalStart();
+	Eigen::Vector3r p_2 = seg_1->GlobalEnd();
+
+	Real a = (p_1 - p_0).norm();
+	Real b = (p_2 - p_1).norm();
+	if (FuzzyZero(a) || FuzzyZero(b))
+		return Super::Update();
+
+	// the goal is clamped into the reach of the limb
+	Eigen::Vector3r d = m_goalT - p_0;
+	Real c = d.norm();
+	if (FuzzyZero(c))
+		d = p_2 - p_0;
+	d.normalize();
+	c = std::max(std::abs(a - b) + c_epsilon, std::min(a + b - c_epsilon, c));
+
+	// the triangle (p_0, p_1', p_2') of sides a, b and c in the bend plane
+	Eigen::Vector3r u = BendDir(d, p_1 - p_0);
+	m_bendG = u;
+	Real cos_alpha = std::max((Real)-1, std::min((Real)1, (a*a + c*c - b*b) / (2*a*c)));
+	Real sin_alpha = sqrt((Real)1 - cos_alpha*cos_alpha);
+	Eigen::Vector3r p_1_prime = p_0 + a * (cos_alpha * d + sin_alpha * u);
+	Eigen::Vector3r p_2_prime = p_0 + c * d;
+
+	// R_0 swings the upper bone around p_0, R_1 swings the swung lower bone around p_1'
+	Eigen::Quaternionr R_0 = Eigen::Quaternionr::FromTwoVectors(p_1 - p_0, p_1_prime - p_0);
+	Eigen::Quaternionr R_1 = Eigen::Quaternionr::FromTwoVectors(R_0 * (p_2 - p_1), p_2_prime - p_1_prime);
+
+	IKNode& node_0 = m_nodes[0];
+	IKNode& node_1 = m_nodes[1];
+	Eigen::Quaternionr Q_0 = Transform::getRotation_q(node_0.body->GetTransformLocal2World());
+	Eigen::Quaternionr Q_1 = Transform::getRotation_q(node_1.body->GetTransformLocal2World());
+	// the elbow is set relative to the upper bone before it is rotated
+	node_1.joint->SetRotation_w((R_0.conjugate() * R_1 * R_0 * Q_1).normalized());
+	node_0.joint->SetRotation_w((R_0 * Q_0).normalized());
+
+	bool clamped_0 = seg_0->Clamp();
+	bool clamped_1 = seg_1->Clamp();
+	CArtiBodyTree::FK_Update<true>(m_rootG);
+	LOGIKVarNJK(LogInfoBool, clamped_0);
+	LOGIKVarNJK(LogInfoBool, clamped_1);
+	if (clamped_0 || clamped_1)
+		return Super::Update();
+
+	if (c_taskW_r > 0)
+	{
+		m_eefSrc->GetJoint()->SetRotation_w(m_goalR);
+		CArtiBodyTree::FK_Update<true>(m_rootG);
+	}
+	return UpdateCompleted();
+}
@@ -0,0 +1,27 @@
+#pragma once
+#include "IKChainInverseJK.hpp"
+
+// the closed form IK of a limb: 2 segments, the upper bone and the lower bone.
+//	the elbow bends towards the pole vector, or in the current bend plane without a pole,
+//	the joints are then clamped into their limits, a clamped posture is solved on by the DLS iterations,
+//	the end effector is rotated to the goal for an orientation task
+class CIKChainTwoBone : public IKChainInverseJK<IK_QJacobianDLS>
+{
+	typedef IKChainInverseJK<IK_QJacobianDLS> Super;
+public:
+	CIKChainTwoBone(Real weight_p, Real weight_r, int n_iter, Real tol_p, Real tol_r, const Real pole[3]);
+	virtual ~CIKChainTwoBone();
+	virtual bool Init(const CArtiBodyNode* eef, int len, const std::vector<CONF::CJointConf>& joint_confs) override;
+	virtual bool BeginUpdate(const Transform_TR& w2g) override;
+	virtual bool Update() override;
+private:
+	// the bend direction perpendicular to the shoulder-goal direction d
+	Eigen::Vector3r BendDir(const Eigen::Vector3r& d, const Eigen::Vector3r& elbow) const;
+private:
+	bool m_poled;
+	Eigen::Vector3r m_poleW;
+	Eigen::Vector3r m_poleG;
+	Eigen::Vector3r m_bendG;		// the bend direction of the last update
+	Eigen::Vector3r m_goalT;
+	Eigen::Quaternionr m_goalR;
+};
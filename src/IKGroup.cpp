@@ -1,6 +1,8 @@
 #include "pch.h"
 #include "IKGroup.hpp"
 #include "IKChainInverseJK.hpp"
+#include "IKChainTwoBone.hpp"
+#include "IKChainGeometric.hpp"
 
 
 CIKGroup::CIKGroup(CArtiBodyNode* root)
@@ -182,6 +184,42 @@ CIKChain* CIKGroup::AddChain(const CONF::CIKChainConf* conf)
 											, conf->tol_p
 											, conf->tol_r);
 			break;
+		case CIKChain::NDLS:
+			chain = new CIKChainInverseJK_NDLS(conf->weight_p
+											, conf->weight_r
+											, conf->n_iter
+											, conf->tol_p
+											, conf->tol_r);
+			break;
+		case CIKChain::TwoBone:
+			chain = new CIKChainTwoBone(conf->weight_p
+									, conf->weight_r
+									, conf->n_iter
+									, conf->tol_p
+									, conf->tol_r
+									, conf->pole);
+			break;
+		case CIKChain::CCD:
+			chain = new CIKChainCCD(conf->weight_p
+								, conf->weight_r
+								, conf->n_iter
+								, conf->tol_p
+								, conf->tol_r);
+			break;
+		case CIKChain::FABRIK:
+			chain = new CIKChainFABRIK(conf->weight_p
+									, conf->weight_r
+									, conf->n_iter
+									, conf->tol_p
+									, conf->tol_r);
+			break;
+		case CIKChain::JT:
+			chain = new CIKChainInverseJK_JT(conf->weight_p
+										, conf->weight_r
+										, conf->n_iter
+										, conf->tol_p
+										, conf->tol_r);
+			break;
 		default:
 			LOGIKVarErr(LogInfoCharPtr, CIKChain::from_Algor(conf->algor)); // not yet supportedthe type
 			break;
@@ -69,6 +69,36 @@ public:
 		return err;
 	}
 
+	// the error with the end effectors of the chains at eefs_g, in the order of Eefs
+	Real Error(const _TRANSFORM* eefs_g) const
+	{
+		Real err = 0;
+		int n_chains = (int)m_kChains.size();
+		for (int i_chain = 0; i_chain < n_chains; i_chain ++)
+			err += m_kChains[i_chain]->Error(eefs_g[i_chain]);
+		return err;
+	}
+
+	void Eefs(std::vector<CArtiBodyNode*>& eefs) const
+	{
+		eefs.clear();
+		for (auto chain_i : m_kChains)
+			eefs.push_back(chain_i->EndEffector());
+	}
+
+	// the position goals of the chains in the order of Eefs: goals_g[i_chain * 3 + (0, 1, 2)]
+	void Goals(Real* goals_g, bool* masks) const
+	{
+		int n_chains = (int)m_kChains.size();
+		for (int i_chain = 0; i_chain < n_chains; i_chain ++)
+			masks[i_chain] = m_kChains[i_chain]->Goal_t(goals_g + i_chain * 3);
+	}
+
+	int NChains() const
+	{
+		return (int)m_kChains.size();
+	}
+
 	CIKChain* AddChain(const CONF::CIKChainConf* conf);
 private:
 	CArtiBodyNode* m_rootBody;
@@ -10,6 +10,8 @@ CIKGroupNode::CIKGroupNode(CArtiBodyNode* root, int concurrency, int attempts)
 	, m_secondary(root, concurrency)
 	, c_restartAttempts(attempts)
 	, m_pg(NULL)
+	, m_pgLoader(NULL)
+	, m_pgResumable(false)
 {
 
 }
@@ -20,10 +22,15 @@ CIKGroupNode::CIKGroupNode(CIKGroupNode& src)
 	, c_restartAttempts(src.c_restartAttempts)
 {
 	m_pg = src.m_pg; src.m_pg = NULL;
+	m_pgLoader = src.m_pgLoader; src.m_pgLoader = NULL;
+	m_pgSettings = src.m_pgSettings;
+	m_pgResumable = false;
 }
 
 CIKGroupNode::~CIKGroupNode()
 {
+	if (NULL != m_pgLoader)
+		delete m_pgLoader;		// waits for the loading thread
 	if (NULL != m_pg)
 		delete m_pg;
 }
@@ -37,23 +44,130 @@ void CIKGroupNode::SetupTargets(const std::map<std::wstring, CArtiBodyNode*>& na
 	m_secondary.SetupTargets(nameSrc2bodyDst, src2dst_w, dst2src_w);
 }
 
-void CIKGroupNode::LoadPostureGraph(const char* pgDir, int radius)
+void CIKGroupNode::LoadPostureGraph(const PGSettings& settings)
 {
 	if (!m_primary.Empty())
 	{
+		m_pgSettings = settings;
+		m_pgSettings.knn = std::max(0, settings.knn);
+		m_pgDeadline.Initialize(m_pgSettings.budget_us);
+		m_pgResumable = false;
+		if (m_pgSettings.knn > 0
+			|| m_pgSettings.resume_dist > 0)
+		{
+			int n_chains = m_primary.NChains();
+			m_goals.resize(n_chains * 3);
+			m_goalMasks.reset(new bool[n_chains]);
+			m_goals_m.resize(n_chains * 3);
+			m_knnPoses.resize(m_pgSettings.knn);
+			m_knnErrs.resize(m_pgSettings.knn);
+		}
+		if (m_pgSettings.async)
+		{
+			m_pgLoader = new CThreadPool_W32<CThreadPGLoad>();
+			std::vector<CArtiBodyNode*> eefs;
+			m_primary.Eefs(eefs);
+			bool initialized = m_pgLoader->Initialize_main(1,
+									[&](CThreadPGLoad* thread)
+										{
+											thread->Initialize_main(m_pgSettings.dir.c_str(), m_primary.RootBody(), eefs, m_pgSettings.index_us > 0, m_pgSettings.knn > 0);
+										});
+			if (initialized)
+				m_pgLoader->WaitForAReadyThread_main(INFINITE)->Load_main();
+			else
+			{
+				delete m_pgLoader;
+				m_pgLoader = NULL;
+			}
+			return;
+		}
+
 		m_pg = new CPGRuntimeParallel();
-		if (!m_pg->Load(pgDir, m_primary.RootBody(), radius))
+		if (!m_pg->Load(m_pgSettings, m_primary.RootBody()))
 		{
 			delete m_pg;
 			m_pg = NULL;
 		}
 		else
 		{
+			std::vector<CArtiBodyNode*> eefs;
+			std::vector<_TRANSFORM> eefs_theta;
+			m_primary.Eefs(eefs);
+			CPGRuntime::ComputeEefs(m_pg->Runtime()->Shared(), m_primary.RootBody(), eefs, eefs_theta);
+			if (m_pgSettings.knn > 0)
+			{
+				CPGEefIndex eefIndex;
+				eefIndex.Build(m_pg->Runtime()->Shared()->Transitions(), eefs_theta, (int)eefs.size());
+				m_pg->Runtime()->SetEefIndex(eefIndex);
+			}
+			m_pg->Runtime()->SetEefs(eefs_theta, (int)eefs.size());
 			m_pg->SetActivePosture<false>(0, true);
+			if (m_pgSettings.augment > 0)
+				m_pg->Augment(m_pgSettings, m_primary.RootBody(), eefs);
 		}
 	}
 }
 
+// it switches to the posture graph once the background loading is done,
+// the switch happens on the main thread between 2 updates, the current posture is kept
+bool CIKGroupNode::PGReady()
+{
+	if (NULL == m_pgLoader)
+		return true;
+
+	CThreadPGLoad* loader = m_pgLoader->WaitForAReadyThread_main(0);
+	if (NULL == loader)
+		return false;
+
+	if (NULL != loader->Loaded_main())
+	{
+		auto root_body = m_primary.RootBody();
+		CArtiBodyTree::Serialize<true>(root_body, m_tmk0);
+		CPGRuntimeParallel* pg = new CPGRuntimeParallel();
+		if (pg->Load(m_pgSettings, root_body))	// the loaded graph is acquired from the registry
+		{
+			pg->Runtime()->SetEefs(loader->Eefs_main(), loader->N_Eefs_main());
+			pg->Runtime()->SetEefIndex(loader->EefIndex_main());
+			if (m_pgSettings.augment > 0)
+			{
+				std::vector<CArtiBodyNode*> eefs;
+				m_primary.Eefs(eefs);
+				pg->Augment(m_pgSettings, root_body, eefs);
+			}
+			m_pg = pg;
+		}
+		else
+			delete pg;
+		CArtiBodyTree::Serialize<false>(root_body, m_tmk0);
+		CArtiBodyTree::FK_Update<false>(root_body);
+	}
+	loader->HoldReadyOn_main();
+	delete m_pgLoader;
+	m_pgLoader = NULL;
+	LOGIKVar(LogInfoBool, (NULL != m_pg));
+	return true;
+}
+
+#if defined PG_STATS
+bool CIKGroupNode::PGStats(PG_Stats& stats) const
+{
+	if (NULL == m_pg)
+		return false;
+	memset(&stats, 0, sizeof(PG_Stats));
+	stats.group = m_primary.RootBody()->GetName_c();
+	m_pgStats.Accumulate(stats);
+	m_pg->Stats(stats);
+	return true;
+}
+
+void CIKGroupNode::PGStatsReset()
+{
+	m_pgStats.Reset();
+	if (NULL != m_pg)
+		m_pg->ResetStats();
+}
+#endif
+
 CIKChain* CIKGroupNode::AddChain(const CONF::CIKChainConf* chainConf)
 {
 	CIKChain* ret = m_primary.AddChain(chainConf);
@@ -66,6 +180,9 @@ void CIKGroupNode::IKUpdate()
 	if (m_primary.Empty())
 		return;
 
+	if (NULL != m_pgLoader)
+		PGReady();				// the group restarts without the posture graph until it is loaded
+
 	// LOGIKErr("BeginPrimaryUpdate");
 	Transform_TR w2g;
 	if (!m_primary.BeginUpdate(&w2g))
@@ -93,16 +210,23 @@ void CIKGroupNode::IKUpdate()
 			CArtiBodyTree::Serialize<true>(root_body, m_tmk0);
 			m_secondary.BeginUpdate(w2g);
 
-			CPGRuntimeParallel::Locker locker;
-			auto pg_seq = m_pg->Lock(&locker);
+			auto pg_seq = m_pg->Runtime();		// the projection workers do not share it, no waiting
 
 			int n_errs = 0;
 			int n_localMinima = 0;
+			bool timed = m_pgDeadline.Enabled();
+			bool expired = false;
+			if (timed)
+				m_pgDeadline.Begin();
 
 			auto IKErr = [&](int pose_id, bool* stop_searching) -> Real
 				{
 					n_errs ++;
-					*stop_searching = (updated || n_errs > m_pg->Radius() || n_localMinima > c_restartAttempts);
+					if (timed)
+						expired = m_pgDeadline.Expired();
+					*stop_searching = (updated
+									|| (timed ? expired : n_errs > m_pg->Radius())
+									|| n_localMinima > c_restartAttempts);
 					if (*stop_searching)
 					{
 						// LOGIKVarErr(LogInfoBool, updated);
@@ -110,8 +234,19 @@ void CIKGroupNode::IKUpdate()
 					}
 					else
 					{
-						pg_seq->SetActivePosture<true>(pose_id, true);
-						Real err = m_primary.Error();
+						// the candidate is scored with the precomputed end effectors without posing the body
+						const _TRANSFORM* eefs = pg_seq->GetEefs(pose_id);
+						Real err;
+						if (NULL != eefs)
+						{
+							pg_seq->SetActivePosture<true>(pose_id, false);
+							err = m_primary.Error(eefs);
+						}
+						else
+						{
+							pg_seq->SetActivePosture<true>(pose_id, true);
+							err = m_primary.Error();
+						}
 						// LOGIKVarErr(LogInfoReal, err);
 						return err;
 					}
@@ -125,8 +260,77 @@ void CIKGroupNode::IKUpdate()
 					updated = m_secondary.Update_A(m_tmk);
 				};
 
-			CPGRuntime::LocalMin(*pg_seq, IKErr, OnPG_Lomin);
-			m_pg->UnLock(locker);
+			if (m_pgSettings.knn > 0
+				|| m_pgSettings.resume_dist > 0)
+				m_primary.Goals(m_goals.data(), m_goalMasks.get());
+
+			// the search of the last frame is resumed if none of the goals moved further than resume_dist
+			bool resume = false;
+			if (m_pgSettings.resume_dist > 0)
+			{
+				Real dist2_max = (Real)0;
+				int n_chains = m_primary.NChains();
+				for (int i_chain = 0; i_chain < n_chains; i_chain ++)
+				{
+					if (!m_goalMasks[i_chain])
+						continue;
+					const Real* goal = &m_goals[i_chain * 3];
+					const Real* goal_m = &m_goals_m[i_chain * 3];
+					Real dx = goal[0] - goal_m[0];
+					Real dy = goal[1] - goal_m[1];
+					Real dz = goal[2] - goal_m[2];
+					dist2_max = std::max(dist2_max, dx*dx + dy*dy + dz*dz);
+				}
+				resume = (m_pgResumable
+						&& dist2_max <= m_pgSettings.resume_dist * m_pgSettings.resume_dist);
+				if (!resume)
+					m_goals_m = m_goals;		// the goals the errors of the frontier are measured with
+			}
+
+			// the restarts are seeded first with the postures nearest to the goals in the whole graph,
+			// then the graph is walked from the active posture as before
+#if defined PG_STATS
+			int n_seeded = 0;
+#endif
+			if (m_pgSettings.knn > 0)
+			{
+				int pose_id_0 = pg_seq->ActivePosture();
+				int n_seeds = pg_seq->NearestEefs(m_goals.data(), m_goalMasks.get(), m_pgSettings.knn, m_knnPoses.data(), m_knnErrs.data());
+				for (int i_seed = 0
+					; i_seed < n_seeds && !updated && n_localMinima <= c_restartAttempts
+						&& !(timed && (expired = m_pgDeadline.Expired()))
+					; i_seed ++)
+					OnPG_Lomin((int)m_knnPoses[i_seed]);
+#if defined PG_STATS
+				n_seeded = n_localMinima;
+#endif
+				if (!updated)						// a seed that converged stays the active posture
+					pg_seq->SetActivePosture<true>(pose_id_0, false);
+			}
+
+			if (!updated)
+			{
+				if (m_pgSettings.resume_dist > 0)
+					CPGRuntime::LocalMin_resume(*pg_seq, resume, IKErr, OnPG_Lomin);
+				else
+					CPGRuntime::LocalMin(*pg_seq, IKErr, OnPG_Lomin);
+			}
+			m_pgResumable = !updated;
+#if defined PG_STATS
+			if (timed)
+			{
+				int64_t us_search = m_pgDeadline.End();
+				PG_STATS_ADD(m_pgStats, EXPIRED, expired);
+				PG_STATS_ADD(m_pgStats, US_SEARCH_TOTAL, us_search);
+				PG_STATS_MAX(m_pgStats, US_SEARCH_MAX, us_search);
+			}
+#endif
+
+			PG_STATS_ADD(m_pgStats, SEARCHES, 1);
+			PG_STATS_ADD(m_pgStats, ERRS, n_errs);
+			PG_STATS_ADD(m_pgStats, LOCAL_MINIMA, n_localMinima - n_seeded);
+			PG_STATS_ADD(m_pgStats, RESTARTS, n_localMinima);
+			PG_STATS_ADD(m_pgStats, EXHAUSTED, (!updated && (timed ? expired : n_errs > m_pg->Radius())));
 
 			if (updated)
 			{
@@ -136,11 +340,13 @@ void CIKGroupNode::IKUpdate()
 			else
 				CArtiBodyTree::Serialize<false>(root_body, m_tmk0);
 
-			// LOGIKVarErr(LogInfoInt, n_errs);
-			// LOGIKVarErr(LogInfoInt, n_localMinima);
+			// a posture the graph did not reach without the secondary IK is grown into the overlay
+			m_pg->UpdateOverlay(updated);
 
 			// LOGIKErr("EndSecondaryUpdate");
 		}
+		else
+			m_pgResumable = false;
 		m_pg->UpdateFKProj();
 	}
 	// LOGIKVarErr(LogInfoCharPtr, root_body->GetName_c());
@@ -152,6 +358,7 @@ void CIKGroupNode::IKUpdate()
 
 void CIKGroupNode::IKReset()
 {
+	m_pgResumable = false;
 	if (m_pg)
 		m_pg->SetActivePosture<false>(0, false);
 	m_primary.IKReset<false>();
@@ -517,11 +724,25 @@ void CIKGroupTree::SetupTargets(CIKGroupNode* root_ik
 	CIKGroupTree::TraverseDFS(root_ik, OnIKGroupNode, OffIKGroupNode);
 }
 
-void CIKGroupTree::LoadPG(CIKGroupNode* root_ik, const char* dirPath, int radius)
+void CIKGroupTree::LoadPG(CIKGroupNode* root_ik, const char* dirPath, const CONF::CBodyConf& bodyConf)
 {
-	auto OnIKGroupNode = [dirPath, radius](CIKGroupNode* gNode)
+	PGSettings settings;
+	settings.dir = dirPath;
+	settings.radius = bodyConf.PG_radius();
+	settings.proj_concurrency = bodyConf.PG_proj_concurrency();
+	settings.proj_shared = bodyConf.PG_proj_shared();
+	settings.index_us = bodyConf.PG_index_us();
+	settings.knn = bodyConf.PG_knn();
+	settings.budget_us = bodyConf.PG_budget_us();
+	settings.resume_dist = bodyConf.PG_resume_dist();
+	settings.augment = bodyConf.PG_augment();
+	settings.augment_err = bodyConf.PG_augment_err();
+	settings.augment_save = bodyConf.PG_augment_save();
+	settings.async = bodyConf.PG_async();
+
+	auto OnIKGroupNode = [&settings](CIKGroupNode* gNode)
 		{
-			gNode->LoadPostureGraph(dirPath, radius);
+			gNode->LoadPostureGraph(settings);
 		};
 
 	auto OffIKGroupNode = [](CIKGroupNode* gNode)
@@ -532,4 +753,61 @@ void CIKGroupTree::LoadPG(CIKGroupNode* root_ik, const char* dirPath, int radius
 	CIKGroupTree::TraverseDFS(root_ik, OnIKGroupNode, OffIKGroupNode);
 }
 
+bool CIKGroupTree::PGReady(CIKGroupNode* root_ik)
+{
+	bool ready = true;
+	auto OnIKGroupNode = [&ready](CIKGroupNode* gNode)
+		{
+			ready = gNode->PGReady() && ready;
+		};
+
+	auto OffIKGroupNode = [](CIKGroupNode* gNode)
+		{
+
+		};
+
+	CIKGroupTree::TraverseDFS(root_ik, OnIKGroupNode, OffIKGroupNode);
+	return ready;
+}
+
+#if defined PG_STATS
+int CIKGroupTree::PGStats(CIKGroupNode* root_ik, PG_Stats* stats, int n_stats)
+{
+	int n_groups = 0;
+	PG_Stats stats_i;
+	auto OnIKGroupNode = [&](CIKGroupNode* gNode)
+		{
+			if (gNode->PGStats(stats_i))
+			{
+				if (n_groups < n_stats)
+					stats[n_groups] = stats_i;
+				n_groups ++;
+			}
+		};
+
+	auto OffIKGroupNode = [](CIKGroupNode* gNode)
+		{
+
+		};
+
+	CIKGroupTree::TraverseDFS(root_ik, OnIKGroupNode, OffIKGroupNode);
+	return n_groups;
+}
+
+void CIKGroupTree::PGStatsReset(CIKGroupNode* root_ik)
+{
+	auto OnIKGroupNode = [](CIKGroupNode* gNode)
+		{
+			gNode->PGStatsReset();
+		};
+
+	auto OffIKGroupNode = [](CIKGroupNode* gNode)
+		{
+
+		};
+
+	CIKGroupTree::TraverseDFS(root_ik, OnIKGroupNode, OffIKGroupNode);
+}
+#endif
+
 #undef COLOR_BOTTOM
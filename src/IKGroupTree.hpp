@@ -1,5 +1,6 @@
 #pragma once
 #include <ostream>
+#include <memory>
 #include "MotionPipeConf.hpp"
 #include "PGRuntimeParallel.hpp"
 #include "IKGroup.hpp"
@@ -15,7 +16,13 @@ public:
 	void IKReset();
 
 	void SetupTargets(const std::map<std::wstring, CArtiBodyNode*>& nameSrc2bodyDst, const Eigen::Matrix3r& src2dst_w, const Eigen::Matrix3r& dst2src_w);
-	void LoadPostureGraph(const char* pgDir, int radius);
+	void LoadPostureGraph(const PGSettings& settings);
+	bool PGReady();
+#if defined PG_STATS
+	// false for a group without a posture graph
+	bool PGStats(PG_Stats& stats) const;
+	void PGStatsReset();
+#endif
 	virtual void Dump(int indent) const override;
 	void Dump(int indent, std::ostream& out) const;
 
@@ -35,6 +42,18 @@ protected:
 	CIKGroupsParallel m_secondary;
 	const int c_restartAttempts;
 	CPGRuntimeParallel* m_pg;
+	CThreadPool_W32<CThreadPGLoad>* m_pgLoader;	// the graph being loaded asynchronously
+	PGSettings m_pgSettings;
+	std::vector<Real> m_goals;			// the position goals of the chains for the search: CIKGroup::Goals
+	std::unique_ptr<bool[]> m_goalMasks;
+	std::vector<uint32_t> m_knnPoses;
+	std::vector<Real> m_knnErrs;
+	CPGSearchDeadline m_pgDeadline;
+#if defined PG_STATS
+	CPGStats m_pgStats;					// of the searches, the projections are counted by m_pg
+#endif
+	bool m_pgResumable;					// the search of the last frame left a frontier
+	std::vector<Real> m_goals_m;		// the goals of the last search
 	TransformArchive m_tmk0; 	//the starting posture for frame k for the secondary solution
 	TransformArchive m_tmk; 	//the ending posture for frame k for the secondary solution
 };
@@ -44,7 +63,12 @@ class CIKGroupTree : public Tree<CIKGroupNode>
 public:
 	static CIKGroupNode* Generate(const CArtiBodyNode* root, const CONF::CBodyConf& ikChainConf);
 	static void SetupTargets(CIKGroupNode* root_ik, const std::map<std::wstring, CArtiBodyNode*>& nameSrc2bodyDst, const Eigen::Matrix3r& src2dst_w, const Eigen::Matrix3r& dst2src_w);
-	static void LoadPG(CIKGroupNode* root_ik, const char* dirPath, int radius);
+	static void LoadPG(CIKGroupNode* root_ik, const char* dirPath, const CONF::CBodyConf& bodyConf);
+	static bool PGReady(CIKGroupNode* root_ik);
+#if defined PG_STATS
+	static int PGStats(CIKGroupNode* root_ik, PG_Stats* stats, int n_stats);
+	static void PGStatsReset(CIKGroupNode* root_ik);
+#endif
 };
 
 
@@ -30,7 +30,58 @@
 #undef min
 #undef max
 
+// the SVD of a TASK x DOF jacobian on the stack, with the same results as SVD_X:
+// a fixed size JacobiSVD has no thin unitaries, the thin ones are the leading columns of the full ones
+template<int TASK, int DOF, bool TRANSPOSE = (TASK < DOF)>
+struct SVD_N;
+
+template<int TASK, int DOF>
+struct SVD_N<TASK, DOF, true>
+{
+  static void Compute(const Eigen::MatrixXr &jacobian, Eigen::MatrixXr &u, Eigen::VectorXr &w, Eigen::MatrixXr &v)
+  {
+    typedef Eigen::Matrix<Real, DOF, TASK> JacobianT;
+    JacobianT jacobian_t = jacobian.transpose();
+    Eigen::JacobiSVD<JacobianT> svd(jacobian_t, Eigen::ComputeFullU | Eigen::ComputeFullV);
+    u = svd.matrixV();
+    w = svd.singularValues();
+    v = svd.matrixU().template leftCols<TASK>();
+  }
+};
+
+template<int TASK, int DOF>
+struct SVD_N<TASK, DOF, false>
+{
+  static void Compute(const Eigen::MatrixXr &jacobian, Eigen::MatrixXr &u, Eigen::VectorXr &w, Eigen::MatrixXr &v)
+  {
+    typedef Eigen::Matrix<Real, TASK, DOF> Jacobian;
+    Jacobian jacobian_n = jacobian;
+    Eigen::JacobiSVD<Jacobian> svd(jacobian_n, Eigen::ComputeFullU | Eigen::ComputeFullV);
+    u = svd.matrixU().template leftCols<DOF>();
+    w = svd.singularValues();
+    v = svd.matrixV();
+  }
+};
+
+// the chains of 1 to 4 segments of 3 DoFs with a position, or a position and orientation task
+static const struct
+{
+  int task_size;
+  int dof;
+  void (*svd)(const Eigen::MatrixXr &, Eigen::MatrixXr &, Eigen::VectorXr &, Eigen::MatrixXr &);
+} c_svds[] = {
+  {3, 3, SVD_N<3, 3>::Compute},
+  {3, 6, SVD_N<3, 6>::Compute},
+  {3, 9, SVD_N<3, 9>::Compute},
+  {3, 12, SVD_N<3, 12>::Compute},
+  {6, 3, SVD_N<6, 3>::Compute},
+  {6, 6, SVD_N<6, 6>::Compute},
+  {6, 9, SVD_N<6, 9>::Compute},
+  {6, 12, SVD_N<6, 12>::Compute},
+};
+
 IK_QJacobian::IK_QJacobian()
+  : m_svd(NULL)
 {
 }
 
@@ -77,8 +128,47 @@ void IK_QJacobian::ArmMatrices(int dof, int task_size)
 
     m_svd_u_beta.resize(task_size);
   }
+
+  m_svd = NULL;
+  for (const auto &svd_n : c_svds) {
+    if (svd_n.task_size == task_size && svd_n.dof == dof)
+      m_svd = svd_n.svd;
+  }
+  if (NULL == m_svd) {
+    // the decomposition of the iterations reuses the workspace of the same size
+    const unsigned int thin = Eigen::ComputeThinU | Eigen::ComputeThinV;
+    if (m_transpose) {
+      m_jacobian_t.resize(dof, task_size);
+      m_svd_x = Eigen::JacobiSVD<Eigen::MatrixXr>(dof, task_size, thin);
+    }
+    else
+      m_svd_x = Eigen::JacobiSVD<Eigen::MatrixXr>(task_size, dof, thin);
+  }
   LOGIKVar(LogInfoInt, dof);
   LOGIKVar(LogInfoInt, task_size);
+  LOGIKVar(LogInfoBool, (NULL != m_svd));
+}
+
+void IK_QJacobian::SVD_X()
+{
+  const unsigned int thin = Eigen::ComputeThinU | Eigen::ComputeThinV;
+  if (m_transpose) {
+    // SVD will decompose Jt into V*W*Ut with U,V orthogonal and W diagonal,
+    // so J = U*W*Vt and Jinv = V*Winv*Ut
+    m_jacobian_t = m_jacobian.transpose();
+    m_svd_x.compute(m_jacobian_t, thin);
+    m_svd_u = m_svd_x.matrixV();
+    m_svd_w = m_svd_x.singularValues();
+    m_svd_v = m_svd_x.matrixU();
+  }
+  else {
+    // SVD will decompose J into U*W*Vt with U,V orthogonal and W diagonal,
+    // so Jinv = V*Winv*Ut
+    m_svd_x.compute(m_jacobian, thin);
+    m_svd_u = m_svd_x.matrixU();
+    m_svd_w = m_svd_x.singularValues();
+    m_svd_v = m_svd_x.matrixV();
+  }
 }
 
 void IK_QJacobian::SetBetas(int id, int, const Eigen::Vector3r &v)
@@ -117,6 +207,8 @@ void IK_QJacobian::Invert()
   // m_d_norm_weight_Info << "\n" << m_d_norm_weight;
   // LOGIKVar(LogInfoCharPtr, m_d_norm_weight_Info.str().c_str());
 
+#if defined _DEBUG
+  // the weights are formatted only for the log, an iteration of a release build allocates nothing
   std::stringstream m_weight_Info;
   m_weight_Info << "\n" << m_weight;
   LOGIKVar(LogInfoCharPtr, m_weight_Info.str().c_str());
@@ -124,24 +216,12 @@ void IK_QJacobian::Invert()
   std::stringstream m_weight_sqrt_Info;
   m_weight_sqrt_Info << "\n" << m_weight_sqrt;
   LOGIKVar(LogInfoCharPtr, m_weight_sqrt_Info.str().c_str());
+#endif
 
-  if (m_transpose) {
-    // SVD will decompose Jt into V*W*Ut with U,V orthogonal and W diagonal,
-    // so J = U*W*Vt and Jinv = V*Winv*Ut
-    Eigen::JacobiSVD<Eigen::MatrixXr> svd(m_jacobian.transpose(),
-                                   Eigen::ComputeThinU | Eigen::ComputeThinV);
-    m_svd_u = svd.matrixV();
-    m_svd_w = svd.singularValues();
-    m_svd_v = svd.matrixU();
-  }
-  else {
-    // SVD will decompose J into U*W*Vt with U,V orthogonal and W diagonal,
-    // so Jinv = V*Winv*Ut
-    Eigen::JacobiSVD<Eigen::MatrixXr> svd(m_jacobian, Eigen::ComputeThinU | Eigen::ComputeThinV);
-    m_svd_u = svd.matrixU();
-    m_svd_w = svd.singularValues();
-    m_svd_v = svd.matrixV();
-  }
+  if (NULL != m_svd)
+    m_svd(m_jacobian, m_svd_u, m_svd_w, m_svd_v);
+  else
+    SVD_X();
 
   LOGIKVar(LogInfoBool, m_transpose);
   LOGIKVar(LogInfoInt, (int)m_svd_u.rows());
@@ -158,7 +238,7 @@ bool IK_QJacobian::ComputeNullProjection()
   const Real epsilon = c_epsilon;
 
   // compute null space projection based on V
-  int i, j, rank = 0;
+  int i, rank = 0;
   for (i = 0; i < m_svd_w.size(); i++)
     if (m_svd_w[i] > epsilon)
       rank++;
@@ -166,24 +246,11 @@ bool IK_QJacobian::ComputeNullProjection()
   if (rank < m_task_size)
     return false;
 
-  Eigen::MatrixXr basis(m_svd_v.rows(), rank);
-  int b = 0;
-
+  // I - basis*basis.transpose(), summed over the basis columns of V in place
+  m_nullspace.setIdentity();
   for (i = 0; i < m_svd_w.size(); i++)
-    if (m_svd_w[i] > epsilon) {
-      for (j = 0; j < m_svd_v.rows(); j++)
-        basis(j, b) = m_svd_v(j, i);
-      b++;
-    }
-
-  m_nullspace = basis * basis.transpose();
-
-  for (i = 0; i < m_nullspace.rows(); i++)
-    for (j = 0; j < m_nullspace.cols(); j++)
-      if (i == j)
-        m_nullspace(i, j) = (Real)1.0 - m_nullspace(i, j);
-      else
-        m_nullspace(i, j) = -m_nullspace(i, j);
+    if (m_svd_w[i] > epsilon)
+      m_nullspace.noalias() -= m_svd_v.col(i) * m_svd_v.col(i).transpose();
 
   return true;
 }
@@ -210,7 +277,7 @@ void IK_QJacobian::SubTask(IK_QJacobian &jacobian)
 void IK_QJacobian::Restrict(Eigen::VectorXr &d_theta, Eigen::MatrixXr &nullspace)
 {
   // subtract part already moved by higher task from beta
-  m_beta = m_beta - m_jacobian * d_theta;
+  m_beta.noalias() -= m_jacobian * d_theta;
 
   // note: should we be using the norm of the unrestricted jacobian for SDLS?
 
@@ -392,7 +459,7 @@ void IK_QJacobianDLS::Invert()
   // rather than matrix*matrix products
 
   // compute Ut*Beta
-  m_svd_u_beta = m_svd_u.transpose() * m_beta;
+  m_svd_u_beta.noalias() = m_svd_u.transpose() * m_beta;
 
   m_d_theta.setZero();
 
@@ -412,6 +479,110 @@ void IK_QJacobianDLS::Invert()
     m_d_theta[j] *= m_weight[j];
 }
 
+void IK_QJacobianNDLS::Invert()
+{
+  // dtheta = Jt*(J*Jt + lambda*I)^-1*beta = (Jt*J + lambda*I)^-1*Jt*beta,
+  // with lambda of IK_QJacobianDLS::Invert: the singular values of J are the square roots
+  // of the eigenvalues of the normal matrix.
+
+  // the SVD drops the singular values below epsilon, they are damped here instead:
+  // lambda is at least epsilon times the largest eigenvalue, so the normal matrix is definite
+
+  const Real epsilon = c_epsilon;
+  const Real max_angle_change = (Real)0.1;
+  const Real x_length = sqrt(m_beta.dot(m_beta));
+
+  if (m_transpose)
+    m_normal.noalias() = m_jacobian * m_jacobian.transpose();
+  else
+    m_normal.noalias() = m_jacobian.transpose() * m_jacobian;
+
+  m_eigen.compute(m_normal, Eigen::EigenvaluesOnly);
+  const Eigen::VectorXr &eigenvalues = m_eigen.eigenvalues(); // in increasing order
+
+  int i;
+  Real w_min = std::numeric_limits<Real>::max();
+
+  for (i = 0; i < eigenvalues.size(); i++) {
+    Real w = sqrt(std::max((Real)0, eigenvalues[i]));
+    if (w > epsilon && w < w_min)
+      w_min = w;
+  }
+
+  // compute lambda damping term
+
+  Real d = x_length / max_angle_change;
+  Real lambda;
+
+  if (w_min <= d / 2)
+    lambda = d / 2;
+  else if (w_min < d)
+    lambda = sqrt(w_min * (d - w_min));
+  else
+    lambda = 0.0;
+
+  lambda *= lambda;
+
+  if (lambda > 10)
+    lambda = 10;
+
+  lambda = std::max(lambda, epsilon * eigenvalues[eigenvalues.size() - 1]);
+
+  LOGIKVar(LogInfoReal, lambda);
+
+  m_normal.diagonal().array() += lambda;
+  m_llt.compute(m_normal);
+  if (Eigen::Success != m_llt.info()) {
+    // a zero jacobian
+    m_d_theta.setZero();
+    return;
+  }
+
+  if (m_transpose) {
+    m_rhs = m_beta;
+    m_llt.solveInPlace(m_rhs);
+    m_d_theta.noalias() = m_jacobian.transpose() * m_rhs;
+  }
+  else {
+    m_d_theta.noalias() = m_jacobian.transpose() * m_beta;
+    m_llt.solveInPlace(m_d_theta);
+  }
+
+  for (i = 0; i < m_d_theta.size(); i++)
+    m_d_theta[i] *= m_weight[i];
+}
+
+void IK_QJacobianJT::Invert()
+{
+  // alpha = <beta, J*Jt*beta> / <J*Jt*beta, J*Jt*beta>,
+  // the step is clamped to the max angle change of IK_QJacobianDLS::Invert
+
+  const Real epsilon = c_epsilon;
+  const Real max_angle_change = (Real)0.1;
+
+  m_d_theta.noalias() = m_jacobian.transpose() * m_beta;
+  m_j_jt_beta.noalias() = m_jacobian * m_d_theta;
+
+  Real j_jt_beta_sqr = m_j_jt_beta.squaredNorm();
+  if (j_jt_beta_sqr < epsilon * epsilon) {
+    m_d_theta.setZero();
+    return;
+  }
+
+  Real alpha = m_beta.dot(m_j_jt_beta) / j_jt_beta_sqr;
+  m_d_theta *= alpha;
+
+  Real d_theta_max = m_d_theta.cwiseAbs().maxCoeff();
+  if (d_theta_max > max_angle_change)
+    m_d_theta *= (max_angle_change / d_theta_max);
+
+  LOGIKVar(LogInfoReal, alpha);
+
+  int i;
+  for (i = 0; i < m_d_theta.size(); i++)
+    m_d_theta[i] *= m_weight[i];
+}
+
 void IK_QJacobian::Lock(int dof_id, Real delta)
 {
   int i;
@@ -454,6 +625,34 @@ IK_QJacobianDLS::IK_QJacobianDLS()
 {
 }
 
+IK_QJacobianNDLS::IK_QJacobianNDLS()
+  : IK_QJacobian()
+{
+}
+
+void IK_QJacobianNDLS::ArmMatrices(int dof, int task_size)
+{
+  IK_QJacobian::ArmMatrices(dof, task_size);
+  int n = m_transpose ? task_size : dof;
+  m_normal.resize(n, n);
+  m_rhs.resize(n);
+  m_eigen = Eigen::SelfAdjointEigenSolver<Eigen::MatrixXr>(n);
+  m_llt = Eigen::LLT<Eigen::MatrixXr>(n);
+  m_svd_w.setZero(); // ComputeNullProjection finds no rank
+}
+
+IK_QJacobianJT::IK_QJacobianJT()
+  : IK_QJacobian()
+{
+}
+
+void IK_QJacobianJT::ArmMatrices(int dof, int task_size)
+{
+  IK_QJacobian::ArmMatrices(dof, task_size);
+  m_j_jt_beta.resize(task_size);
+  m_svd_w.setZero(); // ComputeNullProjection finds no rank
+}
+
 IK_QJacobianSDLS::IK_QJacobianSDLS()
   : IK_QJacobian()
 {
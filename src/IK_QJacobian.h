@@ -67,10 +67,15 @@ public:
   }
 
 protected:
+  // the SVD of the jacobian into U, W and V: J = U*W*Vt, or Jt = V*W*Ut if the jacobian is transposed
+  typedef void (*SVD_Func)(const Eigen::MatrixXr &jacobian, Eigen::MatrixXr &u, Eigen::VectorXr &w, Eigen::MatrixXr &v);
+  // the SVD of the dynamic matrices on the decomposition preallocated by ArmMatrices
+  void SVD_X();
 
   int m_dof;
   int m_task_size; // either 3 for position task of a chain, or 6 for position and orientation task
   bool m_transpose; // m_transpose = (m_task_size < m_dof)
+  SVD_Func m_svd; // on the compile-time dimensions of the common chains, else NULL for SVD_X
 
   // the jacobian matrix and it's null space projector
   Eigen::MatrixXr m_jacobian;
@@ -89,6 +94,10 @@ protected:
 
   Eigen::VectorXr m_svd_u_beta;
 
+  // the dynamic SVD, JacobiSVD takes the transpose jacobian as a matrix
+  Eigen::MatrixXr m_jacobian_t;
+  Eigen::JacobiSVD<Eigen::MatrixXr> m_svd_x;
+
   // dof weighting
   Eigen::VectorXr m_weight;
   Eigen::VectorXr m_weight_sqrt;
@@ -101,6 +110,35 @@ public:
   void Invert();
 };
 
+// the damped least squares of IK_QJacobianDLS by the normal equations instead of the SVD,
+// in the smaller of the task and the DoF spaces: a 3x3 or 6x6 Cholesky solve for the common chains.
+// it keeps no SVD, so a secondary task is not projected on to the null space of the primary one
+class IK_QJacobianNDLS : public IK_QJacobian
+{
+public:
+  IK_QJacobianNDLS();
+  virtual void ArmMatrices(int dof, int task_size) override;
+  void Invert();
+private:
+  Eigen::MatrixXr m_normal; // J*Jt if m_transpose, else Jt*J
+  Eigen::VectorXr m_rhs;
+  Eigen::SelfAdjointEigenSolver<Eigen::MatrixXr> m_eigen;
+  Eigen::LLT<Eigen::MatrixXr> m_llt;
+};
+
+// the jacobian transpose: dtheta = alpha*Jt*beta, alpha minimizes |beta - J*dtheta| along Jt*beta.
+// no decomposition, a matrix-vector product per iteration, at the cost of more iterations.
+// it keeps no SVD, so a secondary task is not projected on to the null space of the primary one
+class IK_QJacobianJT : public IK_QJacobian
+{
+public:
+  IK_QJacobianJT();
+  virtual void ArmMatrices(int dof, int task_size) override;
+  void Invert();
+private:
+  Eigen::VectorXr m_j_jt_beta; // J*Jt*beta
+};
+
 class IK_QJacobianSDLS : public IK_QJacobian
 {
 public:
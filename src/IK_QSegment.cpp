@@ -121,6 +121,16 @@ void IK_QSegmentSO3::Lock(int dof_l, IK_QJacobian &jacobian, Eigen::Vector3r &de
 	jacobian.Lock(m_DoF_id + dof_l, delta[dof_l]);
 }
 
+bool IK_QSegmentSO3::Clamp()
+{
+	bool clamp[3];
+	Eigen::Quaternionr theta = m_joints[0]->GetRotation();
+	bool clamped = ClampST(clamp, theta);
+	if (clamped)
+		m_joints[0]->SetRotation(theta);
+	return clamped;
+}
+
 IK_QIxyzSegment::IK_QIxyzSegment()
 	: IK_QSegmentSO3()
 {
@@ -68,6 +68,11 @@ public:
 		return m_bodies[side]->GetName_c();
 	}
 
+	CArtiBodyNode* GetBody(int side = 0) const
+	{
+		return m_bodies[side];
+	}
+
 	// number of degrees of freedom
 	int NumberOfDoF() const
 	{
@@ -129,6 +134,8 @@ public:
 	// update the angles using the dTheta's computed using the jacobian matrix
 	virtual bool UpdateAngle(const IK_QJacobian &jacobian, Eigen::Vector3r &delta, bool *clamp) = 0;
 	virtual void Lock(int dofId, IK_QJacobian &jacobian, Eigen::Vector3r &delta) = 0;
+	// clamp the current joint rotation into the limits, true: clamp happens
+	virtual bool Clamp() = 0;
 
   	// set joint limits
 	virtual void SetLimit(DOFLim, const Real lims[2]) = 0;
@@ -166,6 +173,7 @@ public:
 	virtual int Locked(bool lock[6]) const;
 	virtual void UnLock();
 	virtual void Lock(int dofId, IK_QJacobian &jacobian, Eigen::Vector3r &delta);
+	virtual bool Clamp();
 protected:
 	//true: clamp happens
 	virtual bool ClampST(bool clamp[3], Eigen::Quaternionr& ori) { return false; };
@@ -54,6 +54,7 @@ namespace CONF
 							, int a_n_iter
 							, Real a_tol_p
 							, Real a_tol_r
+							, const Real a_pole[3]
 							, const char* a_P_Graph)
 		: eef(a_eef_name)
 		, len(a_len)
@@ -63,6 +64,7 @@ namespace CONF
 		, n_iter(a_n_iter)
 		, tol_p(a_tol_p)
 		, tol_r(a_tol_r)
+		, pole {a_pole[0], a_pole[1], a_pole[2]}
 		, P_Graph(a_P_Graph)
 	{
 	}
@@ -91,6 +93,7 @@ namespace CONF
 			n_iter = src.n_iter;
 			tol_p = src.tol_p;
 			tol_r = src.tol_r;
+			memcpy(pole, src.pole, 3 * sizeof(Real));
 		}
 		else if(CIKChain::Proj == src.algor)
 		{
@@ -150,6 +153,16 @@ namespace CONF
 		: m_pgRadius(500)
 		, m_pgRestartConcurrency(6)
 		, m_pgRestartAttempts(30)
+		, m_pgAsync(false)
+		, m_pgProjConcurrency(1)
+		, m_pgProjShared(false)
+		, m_pgIndexBudget(0)
+		, m_pgKnn(0)
+		, m_pgBudget(0)
+		, m_pgResumeDist(0)
+		, m_pgAugment(0)
+		, m_pgAugmentErr((Real)0.1)
+		, m_pgAugmentSave(false)
 	{
 	}
 
@@ -265,6 +278,56 @@ namespace CONF
 		return m_pgRestartAttempts;
 	}
 
+	bool CBodyConf::PG_async() const
+	{
+		return m_pgAsync;
+	}
+
+	int CBodyConf::PG_proj_concurrency() const
+	{
+		return m_pgProjConcurrency;
+	}
+
+	bool CBodyConf::PG_proj_shared() const
+	{
+		return m_pgProjShared;
+	}
+
+	int CBodyConf::PG_index_us() const
+	{
+		return m_pgIndexBudget;
+	}
+
+	int CBodyConf::PG_knn() const
+	{
+		return m_pgKnn;
+	}
+
+	int CBodyConf::PG_budget_us() const
+	{
+		return m_pgBudget;
+	}
+
+	Real CBodyConf::PG_resume_dist() const
+	{
+		return m_pgResumeDist;
+	}
+
+	int CBodyConf::PG_augment() const
+	{
+		return m_pgAugment;
+	}
+
+	Real CBodyConf::PG_augment_err() const
+	{
+		return m_pgAugmentErr;
+	}
+
+	bool CBodyConf::PG_augment_save() const
+	{
+		return m_pgAugmentSave;
+	}
+
 
 	void CBodyConf::SetFileName(const char* filename)
 	{
@@ -302,6 +365,56 @@ namespace CONF
 		m_pgRestartConcurrency = concur;
 	}
 
+	void CBodyConf::SetPGAsync(bool async)
+	{
+		m_pgAsync = async;
+	}
+
+	void CBodyConf::SetPGProjConcurrency(int concur)
+	{
+		m_pgProjConcurrency = concur;
+	}
+
+	void CBodyConf::SetPGProjShared(bool shared)
+	{
+		m_pgProjShared = shared;
+	}
+
+	void CBodyConf::SetPGIndexBudget(int budget_us)
+	{
+		m_pgIndexBudget = budget_us;
+	}
+
+	void CBodyConf::SetPGKnn(int k)
+	{
+		m_pgKnn = k;
+	}
+
+	void CBodyConf::SetPGBudget(int budget_us)
+	{
+		m_pgBudget = budget_us;
+	}
+
+	void CBodyConf::SetPGResumeDist(Real dist)
+	{
+		m_pgResumeDist = dist;
+	}
+
+	void CBodyConf::SetPGAugment(int n_max)
+	{
+		m_pgAugment = n_max;
+	}
+
+	void CBodyConf::SetPGAugmentErr(Real err)
+	{
+		m_pgAugmentErr = err;
+	}
+
+	void CBodyConf::SetPGAugmentSave(bool save)
+	{
+		m_pgAugmentSave = save;
+	}
+
 #ifdef _DEBUG
 	void CBodyConf::Dump_Dbg() const
 	{
@@ -367,9 +480,10 @@ namespace CONF
 						, int n_iter
 						, Real tol_p
 						, Real tol_r
+						, const Real pole[3]
 						, const char* P_Graph)
 	{
-		CIKChainConf chain_conf(eef_name, len, algor, weight_p, weight_r, n_iter, tol_p, tol_r, P_Graph);
+		CIKChainConf chain_conf(eef_name, len, algor, weight_p, weight_r, n_iter, tol_p, tol_r, pole, P_Graph);
 		int i_new_chain = (int)IK_Chains.size();
 		IK_Chains.push_back(chain_conf);
 		m_name2chainIdx[eef_name] = i_new_chain;
@@ -498,6 +612,46 @@ namespace CONF
 					if (TIXML_SUCCESS == ele->QueryIntAttribute("PG_restart_attempts", &attempts))
 						SetPGRestartAttempts(attempts);
 
+					int async;
+					if (TIXML_SUCCESS == ele->QueryIntAttribute("PG_async", &async))
+						SetPGAsync(0 != async);
+
+					int proj_concurrency;
+					if (TIXML_SUCCESS == ele->QueryIntAttribute("PG_proj_concurrency", &proj_concurrency))
+						SetPGProjConcurrency(proj_concurrency);
+
+					int proj_shared;
+					if (TIXML_SUCCESS == ele->QueryIntAttribute("PG_proj_shared", &proj_shared))
+						SetPGProjShared(0 != proj_shared);
+
+					int index_us;
+					if (TIXML_SUCCESS == ele->QueryIntAttribute("PG_index_us", &index_us))
+						SetPGIndexBudget(index_us);
+
+					int knn;
+					if (TIXML_SUCCESS == ele->QueryIntAttribute("PG_knn", &knn))
+						SetPGKnn(knn);
+
+					int budget_us;
+					if (TIXML_SUCCESS == ele->QueryIntAttribute("PG_budget_us", &budget_us))
+						SetPGBudget(budget_us);
+
+					Real resume_dist;
+					if (TIXML_SUCCESS == TiXMLHelper::QueryRealAttribute(ele, "PG_resume_dist", &resume_dist))
+						SetPGResumeDist(resume_dist);
+
+					int augment;
+					if (TIXML_SUCCESS == ele->QueryIntAttribute("PG_augment", &augment))
+						SetPGAugment(augment);
+
+					Real augment_err;
+					if (TIXML_SUCCESS == TiXMLHelper::QueryRealAttribute(ele, "PG_augment_err", &augment_err))
+						SetPGAugmentErr(augment_err);
+
+					int augment_save;
+					if (TIXML_SUCCESS == ele->QueryIntAttribute("PG_augment_save", &augment_save))
+						SetPGAugmentSave(0 != augment_save);
+
 				}
 				else if("IK_Chain" == name)
 				{
@@ -533,6 +687,11 @@ namespace CONF
 					Real tol_r = (Real)15;
 					TiXMLHelper::QueryRealAttribute(ele, "tol_r", &tol_r);
 
+					Real pole[3] = {0};
+					TiXMLHelper::QueryRealAttribute(ele, "pole_x", &pole[0]);
+					TiXMLHelper::QueryRealAttribute(ele, "pole_y", &pole[1]);
+					TiXMLHelper::QueryRealAttribute(ele, "pole_z", &pole[2]);
+
 					const char* P_Graph = ele->Attribute("P_Graph");
 
 					if (numerical_algor)
@@ -544,6 +703,7 @@ namespace CONF
 								, n_iter
 								, tol_p
 								, tol_r
+								, pole
 								, NULL != P_Graph ? P_Graph : "");
 					else
 						AddIKChain(eef_name
@@ -142,6 +142,7 @@ namespace CONF
 					, int n_iter
 					, Real tol_p
 					, Real tol_r
+					, const Real pole[3]
 					, const char* P_Graph);
 		CIKChainConf(const char* eef_name
 					, int len
@@ -166,6 +167,7 @@ namespace CONF
 				int n_iter;
 				Real tol_p;
 				Real tol_r;
+				Real pole[3];	// TwoBone: the bend direction in the world space, 0 for keeping the bend plane
 			};
 			struct //Proj
 			{
@@ -194,6 +196,16 @@ namespace CONF
 		int PG_radius() const;
 		int PG_restart_concurrency() const;
 		int PG_restart_attempts() const;
+		bool PG_async() const;
+		int PG_proj_concurrency() const;
+		bool PG_proj_shared() const;
+		int PG_index_us() const;
+		int PG_knn() const;
+		int PG_budget_us() const;
+		Real PG_resume_dist() const;
+		int PG_augment() const;
+		Real PG_augment_err() const;
+		bool PG_augment_save() const;
 
 		void AddScale(const char* name, Real x, Real y, Real z);
 		void AddTarget(const char* name);
@@ -203,6 +215,16 @@ namespace CONF
 		void SetPGRadius(int radius);
 		void SetPGRestartConcurrency(int concur);
 		void SetPGRestartAttempts(int attempts);
+		void SetPGAsync(bool async);
+		void SetPGProjConcurrency(int concur);
+		void SetPGProjShared(bool shared);
+		void SetPGIndexBudget(int budget_us);
+		void SetPGKnn(int k);
+		void SetPGBudget(int budget_us);
+		void SetPGResumeDist(Real dist);
+		void SetPGAugment(int n_max);
+		void SetPGAugmentErr(Real err);
+		void SetPGAugmentSave(bool save);
 
 		BODY_TYPE type() const;
 
@@ -214,6 +236,7 @@ namespace CONF
 						, int n_iter
 						, Real tol_p
 						, Real tol_r
+						, const Real pole[3]
 						, const char* P_Graph);
 		void AddIKChain(const char* eef_name
 						, int len
@@ -237,6 +260,16 @@ namespace CONF
 		int m_pgRadius;
 		int m_pgRestartConcurrency;
 		int m_pgRestartAttempts;
+		bool m_pgAsync;
+		int m_pgProjConcurrency;
+		bool m_pgProjShared;
+		int m_pgIndexBudget;
+		int m_pgKnn;
+		int m_pgBudget;
+		Real m_pgResumeDist;
+		int m_pgAugment;
+		Real m_pgAugmentErr;
+		bool m_pgAugmentSave;
 	public:
 		std::vector<CIKChainConf> IK_Chains;
 	private:
@@ -0,0 +1,182 @@
+#include "pch.h"
+#include <chrono>
+#include <algorithm>
+#include "PGEefIndex.hpp"
+
+static const uint32_t c_leafSize = 8;
+
+CPGEefIndex::CPGEefIndex()
+	: m_nDims(0)
+{
+}
+
+void CPGEefIndex::Build(const CPGFileMapped& transitions, const std::vector<_TRANSFORM>& eefs_theta, int n_eefs)
+{
+	auto tick_start = std::chrono::steady_clock::now();
+	m_nodes.clear();
+	m_points.clear();
+	m_vertices.clear();
+	uint32_t n_vertices = transitions.N_Vertices();
+	if (0 == n_vertices || n_eefs < 1 || eefs_theta.empty())
+		return;
+
+	// the points are gathered in the order of the vertices, then reordered in the order of the leaves
+	m_nDims = 3 * n_eefs;
+	m_points.resize((std::size_t)n_vertices * m_nDims);
+	m_vertices.resize(n_vertices);
+	for (uint32_t v = 0; v < n_vertices; v ++)
+	{
+		const _TRANSFORM* eefs_v = &eefs_theta[(std::size_t)transitions.Theta(v) * n_eefs];
+		Real* pt = &m_points[(std::size_t)v * m_nDims];
+		for (int i_eef = 0; i_eef < n_eefs; i_eef ++, pt += 3)
+		{
+			pt[0] = eefs_v[i_eef].tt.x;
+			pt[1] = eefs_v[i_eef].tt.y;
+			pt[2] = eefs_v[i_eef].tt.z;
+		}
+		m_vertices[v] = v;
+	}
+
+	BuildNode(0, n_vertices);
+
+	std::vector<Real> points(m_points.size());
+	for (uint32_t i_point = 0; i_point < n_vertices; i_point ++)
+	{
+		const Real* pt_v = &m_points[(std::size_t)m_vertices[i_point] * m_nDims];
+		std::copy(pt_v, pt_v + m_nDims, &points[(std::size_t)i_point * m_nDims]);
+	}
+	m_points.swap(points);
+
+	int n_nodes = (int)m_nodes.size();
+	int ms_build = (int)std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - tick_start).count();
+	LOGIKVar(LogInfoInt, n_nodes);
+	LOGIKVar(LogInfoInt, ms_build);
+}
+
+// a node is split at the median of the dimension of the largest spread,
+// m_points is still in the order of the vertices, m_vertices is partitioned
+int CPGEefIndex::BuildNode(uint32_t i_begin, uint32_t i_end)
+{
+	int i_node = (int)m_nodes.size();
+	Node node = {i_begin, i_end, -1, (Real)0, {-1, -1}};
+	m_nodes.push_back(node);
+	if (i_end - i_begin <= c_leafSize)
+		return i_node;
+
+	int dim_max = 0;
+	Real spread_max = (Real)-1;
+	for (int dim = 0; dim < m_nDims; dim ++)
+	{
+		Real v_min = m_points[(std::size_t)m_vertices[i_begin] * m_nDims + dim];
+		Real v_max = v_min;
+		for (uint32_t i_point = i_begin + 1; i_point < i_end; i_point ++)
+		{
+			Real v_i = m_points[(std::size_t)m_vertices[i_point] * m_nDims + dim];
+			v_min = std::min(v_min, v_i);
+			v_max = std::max(v_max, v_i);
+		}
+		if (v_max - v_min > spread_max)
+		{
+			spread_max = v_max - v_min;
+			dim_max = dim;
+		}
+	}
+	if (!(spread_max > (Real)0))
+		return i_node;			// the points coincide
+
+	uint32_t i_mid = i_begin + ((i_end - i_begin) >> 1);
+	auto Coord = [this, dim_max](uint32_t v)
+		{
+			return m_points[(std::size_t)v * m_nDims + dim_max];
+		};
+	std::nth_element(m_vertices.begin() + i_begin
+					, m_vertices.begin() + i_mid
+					, m_vertices.begin() + i_end
+					, [&](uint32_t v_a, uint32_t v_b) { return Coord(v_a) < Coord(v_b); });
+
+	Real split = Coord(m_vertices[i_mid]);
+	int child_0 = BuildNode(i_begin, i_mid);
+	int child_1 = BuildNode(i_mid, i_end);
+	Node& node_i = m_nodes[i_node];
+	node_i.dim = dim_max;
+	node_i.split = split;
+	node_i.children[0] = child_0;
+	node_i.children[1] = child_1;
+	return i_node;
+}
+
+void CPGEefIndex::Swap(CPGEefIndex& other)
+{
+	std::swap(m_nDims, other.m_nDims);
+	m_nodes.swap(other.m_nodes);
+	m_points.swap(other.m_points);
+	m_vertices.swap(other.m_vertices);
+	m_knn.swap(other.m_knn);
+}
+
+// the same arithmetic as CIKChainNumerical::Error(eef_g) summed up by CIKGroup::Error(eefs_g)
+Real CPGEefIndex::Error(uint32_t i_point, const Real* goals_g, const bool* masks) const
+{
+	const Real* pt = &m_points[(std::size_t)i_point * m_nDims];
+	Real err = (Real)0;
+	int n_eefs = m_nDims / 3;
+	for (int i_eef = 0; i_eef < n_eefs; i_eef ++, pt += 3, goals_g += 3)
+	{
+		if (!masks[i_eef])
+			continue;
+		Real dx = goals_g[0] - pt[0];
+		Real dy = goals_g[1] - pt[1];
+		Real dz = goals_g[2] - pt[2];
+		err += dx*dx + dy*dy + dz*dz;
+	}
+	return err;
+}
+
+void CPGEefIndex::Search(int i_node, const Real* goals_g, const bool* masks, int k)
+{
+	const Node& node = m_nodes[i_node];
+	if (node.dim < 0)
+	{
+		for (uint32_t i_point = node.i_begin; i_point < node.i_end; i_point ++)
+		{
+			Real err = Error(i_point, goals_g, masks);
+			if ((int)m_knn.size() < k)
+			{
+				m_knn.push_back(std::make_pair(err, i_point));
+				std::push_heap(m_knn.begin(), m_knn.end());
+			}
+			else if (err < m_knn.front().first)
+			{
+				std::pop_heap(m_knn.begin(), m_knn.end());
+				m_knn.back() = std::make_pair(err, i_point);
+				std::push_heap(m_knn.begin(), m_knn.end());
+			}
+		}
+		return;
+	}
+
+	Real d = goals_g[node.dim] - node.split;
+	int near = (d < (Real)0) ? 0 : 1;
+	Search(node.children[near], goals_g, masks, k);
+	// the far side is at least d*d away on a dimension of a goal
+	Real err_far = masks[node.dim / 3] ? d * d : (Real)0;
+	if ((int)m_knn.size() < k
+		|| err_far < m_knn.front().first)
+		Search(node.children[1 - near], goals_g, masks, k);
+}
+
+int CPGEefIndex::Nearest(const Real* goals_g, const bool* masks, int k, uint32_t* vertices, Real* errs)
+{
+	if (Empty() || k < 1)
+		return 0;
+	m_knn.clear();
+	Search(0, goals_g, masks, k);
+	std::sort_heap(m_knn.begin(), m_knn.end());
+	int n_knn = (int)m_knn.size();
+	for (int i_knn = 0; i_knn < n_knn; i_knn ++)
+	{
+		vertices[i_knn] = m_vertices[m_knn[i_knn].second];
+		errs[i_knn] = m_knn[i_knn].first;
+	}
+	return n_knn;
+}
@@ -0,0 +1,46 @@
+#pragma once
+#include <stdint.h>
+#include <vector>
+#include <utility>
+#include "Transform.hpp"
+#include "PGFileMapped.hpp"
+
+// the task space index of a posture graph, a kd-tree over the end effectors of the vertices:
+//	a vertex is a point of 3 * n_eefs dimensions, the end effector positions in the group space,
+//	a query with the goals of the chains returns the k vertices of the least sum of the squared distances
+//	from the end effectors to the goals, which is CIKGroup::Error with the precomputed end effectors.
+//	the end effectors of the chains without a position goal are masked out of the distance
+class CPGEefIndex
+{
+public:
+	CPGEefIndex();
+	// eefs_theta is [theta][i_eef], the table of CPGRuntime::ComputeEefs
+	void Build(const CPGFileMapped& transitions, const std::vector<_TRANSFORM>& eefs_theta, int n_eefs);
+	void Swap(CPGEefIndex& other);
+
+	bool Empty() const
+	{
+		return m_nodes.empty();
+	}
+
+	// goals_g is [i_eef][x, y, z], masks[i_eef] is false for an end effector without a position goal,
+	// returns the number of vertices written into vertices and errs in the order of the error, at most k
+	int Nearest(const Real* goals_g, const bool* masks, int k, uint32_t* vertices, Real* errs);
+private:
+	int BuildNode(uint32_t i_begin, uint32_t i_end);
+	void Search(int i_node, const Real* goals_g, const bool* masks, int k);
+	Real Error(uint32_t i_point, const Real* goals_g, const bool* masks) const;
+private:
+	struct Node
+	{
+		uint32_t i_begin, i_end;	// the points of the node
+		int dim;					// -1 for a leaf
+		Real split;
+		int children[2];
+	};
+	int m_nDims;
+	std::vector<Node> m_nodes;
+	std::vector<Real> m_points;					// [point][dim], points in the order of the leaves
+	std::vector<uint32_t> m_vertices;			// [point]
+	std::vector<std::pair<Real, uint32_t>> m_knn;	// max-heap of (error, point) of a query
+};
@@ -0,0 +1,212 @@
+#include "pch.h"
+#include <windows.h>
+#include <fstream>
+#include <sstream>
+#include "PGFileMapped.hpp"
+#include "ik_logger.h"
+
+CPGFileMapped::CPGFileMapped()
+	: m_view(NULL)
+	, m_nVertices(0)
+	, m_nEdges(0)
+	, m_row(NULL)
+	, m_adj(NULL)
+	, m_v2theta(NULL)
+	, m_weights(NULL)
+{
+}
+
+CPGFileMapped::~CPGFileMapped()
+{
+	Unmap();
+}
+
+bool CPGFileMapped::Recognize(const char* filePath)
+{
+	std::ifstream file(filePath, std::ifstream::binary);
+	uint32_t magic = 0;
+	file.read((char*)&magic, sizeof(magic));
+	return file.good()
+		&& PG_FILE_MAGIC == magic;
+}
+
+bool CPGFileMapped::Save(const char* filePath
+						, const std::vector<uint32_t>& row
+						, const std::vector<uint32_t>& adj
+						, const std::vector<uint32_t>& v2theta
+						, const std::vector<float>& weights)
+{
+	IKAssert(row.size() == v2theta.size() + 1
+		&& row.back() == (uint32_t)adj.size()
+		&& 0 == adj.size() % 2
+		&& (weights.empty() || weights.size() == adj.size()));
+
+	PG_FILE_HEADER header = {0};
+	header.magic = PG_FILE_MAGIC;
+	header.version = PG_FILE_VERSION;
+	header.n_vertices = (uint32_t)v2theta.size();
+	header.n_edges = (uint32_t)(adj.size() >> 1);
+	header.offset_row = sizeof(PG_FILE_HEADER);
+	header.offset_adj = header.offset_row + row.size() * sizeof(uint32_t);
+	header.offset_v2theta = header.offset_adj + adj.size() * sizeof(uint32_t);
+	header.size = header.offset_v2theta + v2theta.size() * sizeof(uint32_t);
+	if (!weights.empty())
+	{
+		header.offset_reserved[0] = header.size;
+		header.size += weights.size() * sizeof(float);
+	}
+
+	std::ofstream file(filePath, std::ofstream::binary);
+	IKAssert(std::ios_base::failbit != file.rdstate());
+	if (std::ios_base::failbit == file.rdstate())
+	{
+		LOGIKVarErr(LogInfoCharPtr, filePath);
+		return false;
+	}
+	file.write((const char*)&header, sizeof(PG_FILE_HEADER));
+	file.write((const char*)row.data(), row.size() * sizeof(uint32_t));
+	file.write((const char*)adj.data(), adj.size() * sizeof(uint32_t));
+	file.write((const char*)v2theta.data(), v2theta.size() * sizeof(uint32_t));
+	if (!weights.empty())
+		file.write((const char*)weights.data(), weights.size() * sizeof(float));
+	return file.good();
+}
+
+bool CPGFileMapped::Valid(const PG_FILE_HEADER& header, uint64_t size)
+{
+	uint64_t n_v = header.n_vertices;
+	uint64_t n_e = header.n_edges;
+	return PG_FILE_MAGIC == header.magic
+		&& PG_FILE_VERSION == header.version
+		&& size == header.size
+		&& 0 == (header.offset_row % sizeof(uint32_t))
+		&& 0 == (header.offset_adj % sizeof(uint32_t))
+		&& 0 == (header.offset_v2theta % sizeof(uint32_t))
+		&& header.offset_row + (n_v + 1) * sizeof(uint32_t) <= size
+		&& header.offset_adj + (n_e << 1) * sizeof(uint32_t) <= size
+		&& header.offset_v2theta + n_v * sizeof(uint32_t) <= size
+		&& 0 == (header.offset_reserved[0] % sizeof(float))
+		&& (0 == header.offset_reserved[0]
+			|| header.offset_reserved[0] + (n_e << 1) * sizeof(float) <= size);
+}
+
+// the file is mapped read-only: no allocation happens for vertices or edges,
+// pages are loaded on demand by the search and shared with the other processes mapping the same file
+bool CPGFileMapped::Map(const char* filePath)
+{
+	Unmap();
+	HANDLE file = INVALID_HANDLE_VALUE;
+	HANDLE mapping = NULL;
+	bool mapped = false;
+	try
+	{
+		file = CreateFileA(filePath
+						, GENERIC_READ
+						, FILE_SHARE_READ
+						, NULL
+						, OPEN_EXISTING
+						, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_RANDOM_ACCESS
+						, NULL);
+		if (INVALID_HANDLE_VALUE == file)
+			throw std::string("open file failed");
+
+		LARGE_INTEGER size;
+		if (!GetFileSizeEx(file, &size)
+			|| size.QuadPart < (LONGLONG)sizeof(PG_FILE_HEADER))
+			throw std::string("the file is not a posture graph");
+
+		mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+		if (NULL == mapping)
+			throw std::string("create file mapping failed");
+
+		m_view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+		if (NULL == m_view)
+			throw std::string("map view of file failed");
+
+		// the view keeps the mapping and the file alive
+		CloseHandle(mapping); mapping = NULL;
+		CloseHandle(file); file = INVALID_HANDLE_VALUE;
+
+		const char* base = (const char*)m_view;
+		const PG_FILE_HEADER* header = (const PG_FILE_HEADER*)base;
+		if (!Valid(*header, (uint64_t)size.QuadPart))
+			throw std::string("invalid posture graph header");
+
+		m_nVertices = header->n_vertices;
+		m_nEdges = header->n_edges;
+		m_row = (const uint32_t*)(base + header->offset_row);
+		m_adj = (const uint32_t*)(base + header->offset_adj);
+		m_v2theta = (const uint32_t*)(base + header->offset_v2theta);
+		if (0 != header->offset_reserved[0])
+			m_weights = (const float*)(base + header->offset_reserved[0]);
+		// the search reads the rows and the adjacency unchecked, a corrupt file fails here in 1 pass
+		if (!ValidCSR())
+			throw std::string("invalid posture graph adjacency");
+		mapped = true;
+	}
+	catch (std::string& exp)
+	{
+		std::stringstream errInfo;
+		errInfo << "Map " << filePath << " " << exp;
+		LOGIKVarErr(LogInfoCharPtr, errInfo.str().c_str());
+		if (NULL != mapping)
+			CloseHandle(mapping);
+		if (INVALID_HANDLE_VALUE != file)
+			CloseHandle(file);
+		Unmap();
+	}
+	return mapped;
+}
+
+bool CPGFileMapped::ValidCSR() const
+{
+	uint32_t n_adj = (m_nEdges << 1);
+	bool valid = (0 == m_row[0]
+				&& n_adj == m_row[m_nVertices]);
+	for (uint32_t v = 0; v < m_nVertices && valid; v ++)
+		valid = (m_row[v] <= m_row[v + 1]);
+	for (uint32_t i_adj = 0; i_adj < n_adj && valid; i_adj ++)
+		valid = (m_adj[i_adj] < m_nVertices);
+	return valid;
+}
+
+bool CPGFileMapped::ValidThetas(uint32_t n_thetas) const
+{
+	bool valid = true;
+	for (uint32_t v = 0; v < m_nVertices && valid; v ++)
+		valid = (m_v2theta[v] < n_thetas);
+	return valid;
+}
+
+void CPGFileMapped::Assign(std::vector<uint32_t>& row
+						, std::vector<uint32_t>& adj
+						, std::vector<uint32_t>& v2theta)
+{
+	Unmap();
+	IKAssert(row.size() == v2theta.size() + 1
+		&& row.back() == (uint32_t)adj.size());
+	m_rowOwned.swap(row);
+	m_adjOwned.swap(adj);
+	m_v2thetaOwned.swap(v2theta);
+	m_nVertices = (uint32_t)m_v2thetaOwned.size();
+	m_nEdges = (uint32_t)(m_adjOwned.size() >> 1);
+	m_row = m_rowOwned.data();
+	m_adj = m_adjOwned.data();
+	m_v2theta = m_v2thetaOwned.data();
+}
+
+void CPGFileMapped::Unmap()
+{
+	if (NULL != m_view)
+		UnmapViewOfFile(m_view);
+	m_view = NULL;
+	m_nVertices = 0;
+	m_nEdges = 0;
+	m_row = NULL;
+	m_adj = NULL;
+	m_v2theta = NULL;
+	m_weights = NULL;
+	m_rowOwned.clear();
+	m_adjOwned.clear();
+	m_v2thetaOwned.clear();
+}
@@ -0,0 +1,118 @@
+#pragma once
+#include <stdint.h>
+#include <vector>
+#include <string>
+
+// the read-only posture graph file (.pg):
+//		[PG_FILE_HEADER][row: uint32_t x (n_vertices+1)][adj: uint32_t x (2*n_edges)][v2theta: uint32_t x n_vertices]
+//	the adjacency is stored in CSR form, the neighbors of vertex v are adj[row[v]], ..., adj[row[v+1]-1],
+//	v2theta[v] is the index of the posture (frame of the .htr file) for vertex v.
+//	an edge weighted graph has [weights: float x (2*n_edges)] at offset_reserved[0],
+//	weights[i] is TransformArchive::Error_q of the 2 postures of edge adj[i], aligned with adj.
+//	the runtime maps the file into memory and searches the graph in place without parsing,
+//	processes on the same host that map the same file share its pages.
+#define PG_FILE_MAGIC	0x4d475048	// "HPGM"
+#define PG_FILE_VERSION	1
+
+typedef struct _PG_FILE_HEADER
+{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t n_vertices;
+	uint32_t n_edges;				// undirected edges, each edge appears twice in adj
+	uint64_t offset_row;			// byte offsets from the beginning of the file
+	uint64_t offset_adj;
+	uint64_t offset_v2theta;
+	uint64_t offset_reserved[4];	// 0 for not present, [0]: the edge weights
+	uint64_t size;					// file size in bytes
+} PG_FILE_HEADER;
+
+static_assert(sizeof(PG_FILE_HEADER) == 80, "PG_FILE_HEADER is part of the file format");
+
+class CPGFileMapped
+{
+public:
+	CPGFileMapped();
+	~CPGFileMapped();
+	CPGFileMapped(const CPGFileMapped&) = delete;
+	CPGFileMapped& operator=(const CPGFileMapped&) = delete;
+
+	static bool Recognize(const char* filePath);
+	static bool Save(const char* filePath
+				, const std::vector<uint32_t>& row
+				, const std::vector<uint32_t>& adj
+				, const std::vector<uint32_t>& v2theta
+				, const std::vector<float>& weights);	// empty for an unweighted graph
+
+	bool Map(const char* filePath);
+	// for the graph not from a mapped file: e.g. converted from the legacy boost archive
+	void Assign(std::vector<uint32_t>& row
+			, std::vector<uint32_t>& adj
+			, std::vector<uint32_t>& v2theta);
+	void Unmap();
+	// v2theta indexes the postures of the theta file the graph is loaded with
+	bool ValidThetas(uint32_t n_thetas) const;
+
+	bool Mapped() const
+	{
+		return NULL != m_view;
+	}
+
+	uint32_t N_Vertices() const
+	{
+		return m_nVertices;
+	}
+
+	uint32_t N_Edges() const
+	{
+		return m_nEdges;
+	}
+
+	uint32_t Degree(uint32_t v) const
+	{
+		return m_row[v + 1] - m_row[v];
+	}
+
+	const uint32_t* AdjacentBegin(uint32_t v) const
+	{
+		return m_adj + m_row[v];
+	}
+
+	const uint32_t* AdjacentEnd(uint32_t v) const
+	{
+		return m_adj + m_row[v + 1];
+	}
+
+	uint32_t Theta(uint32_t v) const
+	{
+		return m_v2theta[v];
+	}
+
+	bool Weighted() const
+	{
+		return NULL != m_weights;
+	}
+
+	// the weights of the edges from v, aligned with AdjacentBegin(v)
+	const float* WeightBegin(uint32_t v) const
+	{
+		return m_weights + m_row[v];
+	}
+
+private:
+	static bool Valid(const PG_FILE_HEADER& header, uint64_t size);
+	// the rows are monotonic from 0 to 2*n_edges, the adjacent vertices are in the graph
+	bool ValidCSR() const;
+
+private:
+	void* m_view;
+	uint32_t m_nVertices;
+	uint32_t m_nEdges;
+	const uint32_t* m_row;
+	const uint32_t* m_adj;
+	const uint32_t* m_v2theta;
+	const float* m_weights;					// NULL for an unweighted graph
+	std::vector<uint32_t> m_rowOwned;
+	std::vector<uint32_t> m_adjOwned;
+	std::vector<uint32_t> m_v2thetaOwned;
+};
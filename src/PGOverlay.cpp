@@ -0,0 +1,271 @@
+#include "pch.h"
+#include <fstream>
+#include "PGOverlay.hpp"
+
+CPGOverlay::CPGOverlay()
+	: m_transitions(NULL)
+	, m_nBase(0)
+	, m_nEefs(0)
+	, m_nRowsGrown(0)
+{
+}
+
+void CPGOverlay::Initialize(const CPGFileMapped* transitions, int n_eefs)
+{
+	m_transitions = transitions;
+	m_nBase = transitions->N_Vertices();
+	m_nEefs = n_eefs;
+	m_thetas.clear();
+	m_eefs.clear();
+	m_anchors.clear();
+	m_rows.clear();
+	m_baseRows.clear();
+	m_baseVertices.clear();
+	m_baseIndex.clear();
+	m_adj.clear();
+	m_rowsGrown.clear();
+	m_nRowsGrown = 0;
+}
+
+void CPGOverlay::Reserve(int n_overlay, int n_joints, int n_links)
+{
+	IKAssert(0 == N_Overlay());
+	std::size_t n_base = (std::size_t)n_overlay * n_links;
+	m_thetas.assign(n_overlay, TransformArchive(n_joints));
+	m_eefs.reserve((std::size_t)n_overlay * m_nEefs);
+	m_anchors.reserve(n_overlay);
+	m_rows.reserve(n_overlay);
+	m_baseRows.reserve(n_base);
+	m_baseVertices.reserve(n_base);
+	m_baseIndex.reserve(n_base);
+}
+
+void CPGOverlay::IndexBase(vertex_descriptor v, uint32_t i_base)
+{
+	auto item = std::make_pair(v, i_base);
+	m_baseIndex.insert(std::upper_bound(m_baseIndex.begin(), m_baseIndex.end(), item), item);
+}
+
+void CPGOverlay::Update(const CPGOverlay& src)
+{
+	IKAssert(src.m_nBase == m_nBase
+		&& src.m_nEefs == m_nEefs
+		&& src.N_Overlay() >= N_Overlay());
+	uint32_t n_overlay = N_Overlay();
+	uint32_t n_overlay_src = src.N_Overlay();
+	for (uint32_t i_v = n_overlay; i_v < n_overlay_src; i_v ++)
+	{
+		if (i_v < (uint32_t)m_thetas.size())
+			m_thetas[i_v] = src.m_thetas[i_v];
+		else
+			m_thetas.push_back(src.m_thetas[i_v]);
+		m_anchors.push_back(src.m_anchors[i_v]);
+		m_rows.push_back(src.m_rows[i_v]);
+	}
+	m_eefs.insert(m_eefs.end(), src.m_eefs.begin() + (std::size_t)n_overlay * m_nEefs, src.m_eefs.end());
+
+	uint32_t n_base = (uint32_t)m_baseRows.size();
+	uint32_t n_base_src = (uint32_t)src.m_baseRows.size();
+	for (uint32_t i_base = n_base; i_base < n_base_src; i_base ++)
+	{
+		m_baseRows.push_back(src.m_baseRows[i_base]);
+		m_baseVertices.push_back(src.m_baseVertices[i_base]);
+		IndexBase(src.m_baseVertices[i_base], i_base);
+	}
+
+	// the rows appended since the last update are in the tail of the adjacency,
+	//	the rows grown before are copied as logged
+	m_adj.insert(m_adj.end(), src.m_adj.begin() + m_adj.size(), src.m_adj.end());
+	for (std::size_t i_grown = m_nRowsGrown; i_grown < src.m_rowsGrown.size(); i_grown ++)
+	{
+		vertex_descriptor v = src.m_rowsGrown[i_grown];
+		const Row* row_src = src.FindRow(v);
+		Row* row = FindRow(v);
+		IKAssert(NULL != row_src && NULL != row);
+		*row = *row_src;
+		std::copy(src.m_adj.begin() + row->begin, src.m_adj.begin() + row->end, m_adj.begin() + row->begin);
+	}
+	m_nRowsGrown = src.m_rowsGrown.size();
+}
+
+void CPGOverlayGen::Initialize(const CPGFileMapped* transitions, int n_eefs)
+{
+	m_overlay.Initialize(transitions, n_eefs);
+	m_rowsCap.clear();
+	m_baseRowsCap.clear();
+	m_linksInserted.clear();
+}
+
+CPGOverlayGen::vertex_descriptor CPGOverlayGen::Insert(const TransformArchive& theta
+													, const _TRANSFORM* eefs
+													, const vertex_descriptor* links
+													, int n_links
+													, vertex_descriptor anchor)
+{
+	vertex_descriptor v = m_overlay.N_Vertices();
+	IKAssert(!m_overlay.Contains(anchor));
+	m_overlay.m_thetas.push_back(theta);
+	m_overlay.m_eefs.insert(m_overlay.m_eefs.end(), eefs, eefs + m_overlay.m_nEefs);
+	m_overlay.m_anchors.push_back(anchor);
+	m_linksInserted.push_back(std::vector<vertex_descriptor>(links, links + n_links));
+
+	// the row of the new vertex has the room for as many edges from the vertices inserted later
+	CPGOverlay::Row row_v;
+	row_v.begin = AppendRow(links, links + n_links, 2 * n_links);
+	row_v.end = row_v.begin + n_links;
+	m_overlay.m_rows.push_back(row_v);
+	m_rowsCap.push_back(row_v.begin + 2 * n_links);
+
+	for (int i_link = 0; i_link < n_links; i_link ++)
+	{
+		vertex_descriptor v_n = links[i_link];
+		IKAssert(v_n < v);
+		AppendEdge(v_n, v);
+	}
+	return v;
+}
+
+uint32_t CPGOverlayGen::AppendRow(const vertex_descriptor* begin, const vertex_descriptor* end, uint32_t capacity)
+{
+	std::vector<vertex_descriptor>& adj = m_overlay.m_adj;
+	uint32_t row_begin = (uint32_t)adj.size();
+	IKAssert((std::size_t)(end - begin) <= capacity);
+	adj.insert(adj.end(), begin, end);
+	adj.resize((std::size_t)row_begin + capacity, 0);
+	return row_begin;
+}
+
+void CPGOverlayGen::AppendEdge(vertex_descriptor v, vertex_descriptor v_n)
+{
+	CPGOverlay::Row* row = m_overlay.FindRow(v);
+	uint32_t* cap = NULL;
+	if (NULL == row)
+	{
+		// the vertex of the graph is linked the first time
+		const CPGFileMapped* transitions = m_overlay.m_transitions;
+		const vertex_descriptor* adj_begin = transitions->AdjacentBegin(v);
+		const vertex_descriptor* adj_end = transitions->AdjacentEnd(v);
+		uint32_t n_adj = (uint32_t)(adj_end - adj_begin);
+		uint32_t i_base = (uint32_t)m_overlay.m_baseRows.size();
+		CPGOverlay::Row row_v;
+		row_v.begin = AppendRow(adj_begin, adj_end, 2 * (n_adj + 1));
+		row_v.end = row_v.begin + n_adj;
+		m_overlay.m_baseRows.push_back(row_v);
+		m_overlay.m_baseVertices.push_back(v);
+		m_overlay.IndexBase(v, i_base);
+		m_baseRowsCap.push_back(row_v.begin + 2 * (n_adj + 1));
+		row = &m_overlay.m_baseRows[i_base];
+		cap = &m_baseRowsCap[i_base];
+	}
+	else if (m_overlay.Contains(v))
+		cap = &m_rowsCap[v - m_overlay.m_nBase];
+	else
+		cap = &m_baseRowsCap[row - m_overlay.m_baseRows.data()];
+
+	if (row->end == *cap)
+	{
+		uint32_t n_adj = row->end - row->begin;
+		uint32_t capacity = std::max(2 * n_adj, (uint32_t)4);
+		std::vector<vertex_descriptor>& adj = m_overlay.m_adj;
+		uint32_t row_begin = (uint32_t)adj.size();
+		adj.resize((std::size_t)row_begin + capacity, 0);
+		std::copy(adj.begin() + row->begin, adj.begin() + row->end, adj.begin() + row_begin);
+		row->begin = row_begin;
+		row->end = row_begin + n_adj;
+		*cap = row_begin + capacity;
+	}
+	m_overlay.m_adj[row->end ++] = v_n;
+	m_overlay.m_rowsGrown.push_back(v);
+}
+
+bool CPGOverlayGen::Save(const char* filePath) const
+{
+	uint32_t n_vertices = m_overlay.N_Overlay();
+	uint32_t n_joints = (n_vertices > 0) ? (uint32_t)m_overlay.m_thetas[0].Size() : 0;
+	PGO_FILE_HEADER header = {0};
+	header.magic = PGO_FILE_MAGIC;
+	header.version = PGO_FILE_VERSION;
+	header.n_base = m_overlay.m_nBase;
+	header.n_vertices = n_vertices;
+	header.n_joints = n_joints;
+	header.n_eefs = (uint32_t)m_overlay.m_nEefs;
+
+	std::ofstream file(filePath, std::ofstream::binary);
+	if (std::ios_base::failbit == file.rdstate())
+	{
+		LOGIKVarErr(LogInfoCharPtr, filePath);
+		return false;
+	}
+	file.write((const char*)&header, sizeof(PGO_FILE_HEADER));
+	for (uint32_t i_v = 0; i_v < n_vertices; i_v ++)
+	{
+		const TransformArchive& theta = m_overlay.m_thetas[i_v];
+		for (uint32_t i_joint = 0; i_joint < n_joints; i_joint ++)
+			file.write((const char*)&theta[(int)i_joint], sizeof(_TRANSFORM));
+	}
+	file.write((const char*)m_overlay.m_eefs.data(), m_overlay.m_eefs.size() * sizeof(_TRANSFORM));
+	file.write((const char*)m_overlay.m_anchors.data(), m_overlay.m_anchors.size() * sizeof(uint32_t));
+	for (const auto& links_v : m_linksInserted)
+	{
+		uint32_t n_links = (uint32_t)links_v.size();
+		file.write((const char*)&n_links, sizeof(uint32_t));
+	}
+	for (const auto& links_v : m_linksInserted)
+		file.write((const char*)links_v.data(), links_v.size() * sizeof(uint32_t));
+	return file.good();
+}
+
+bool CPGOverlayGen::Load(const char* filePath, int n_joints)
+{
+	std::ifstream file(filePath, std::ifstream::binary);
+	if (!file.good())
+		return false;
+
+	PGO_FILE_HEADER header = {0};
+	file.read((char*)&header, sizeof(PGO_FILE_HEADER));
+	bool valid = (file.good()
+				&& PGO_FILE_MAGIC == header.magic
+				&& PGO_FILE_VERSION == header.version
+				&& m_overlay.m_nBase == header.n_base
+				&& (uint32_t)n_joints == header.n_joints
+				&& (uint32_t)m_overlay.m_nEefs == header.n_eefs);
+	if (!valid)
+	{
+		LOGIKVarErr(LogInfoCharPtr, filePath);
+		return false;
+	}
+
+	uint32_t n_vertices = header.n_vertices;
+	std::vector<TransformArchive> thetas(n_vertices, TransformArchive(n_joints));
+	for (auto& theta : thetas)
+	{
+		for (int i_joint = 0; i_joint < n_joints; i_joint ++)
+			file.read((char*)&theta[i_joint], sizeof(_TRANSFORM));
+	}
+	std::vector<_TRANSFORM> eefs((std::size_t)n_vertices * header.n_eefs);
+	std::vector<uint32_t> anchors(n_vertices);
+	std::vector<uint32_t> n_links(n_vertices);
+	file.read((char*)eefs.data(), eefs.size() * sizeof(_TRANSFORM));
+	file.read((char*)anchors.data(), anchors.size() * sizeof(uint32_t));
+	file.read((char*)n_links.data(), n_links.size() * sizeof(uint32_t));
+	std::vector<uint32_t> links;
+	for (uint32_t i_v = 0; i_v < n_vertices && file.good(); i_v ++)
+	{
+		links.resize(n_links[i_v]);
+		file.read((char*)links.data(), links.size() * sizeof(uint32_t));
+		bool valid_v = (file.good()
+					&& !m_overlay.Contains(anchors[i_v]));
+		for (auto v_n : links)
+			valid_v = valid_v && (v_n < m_overlay.N_Vertices());
+		if (!valid_v)
+		{
+			LOGIKVarErr(LogInfoCharPtr, filePath);
+			Initialize(m_overlay.m_transitions, m_overlay.m_nEefs);
+			return false;
+		}
+		Insert(thetas[i_v], eefs.data() + (std::size_t)i_v * header.n_eefs, links.data(), (int)links.size(), anchors[i_v]);
+	}
+	uint32_t n_overlay = m_overlay.N_Overlay();
+	LOGIKVar(LogInfoInt, n_overlay);
+	return n_overlay == n_vertices;
+}
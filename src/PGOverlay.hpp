@@ -0,0 +1,171 @@
+#pragma once
+#include <stdint.h>
+#include <vector>
+#include <algorithm>
+#include "Transform.hpp"
+#include "PGFileMapped.hpp"
+
+// the overlay of a posture graph: the postures solved at runtime linked into the read-only graph of a process.
+//	an overlay vertex is numbered after the vertices of the graph, N_Base() + i, it keeps its own posture,
+//	the end effectors of the posture, and its anchor: the vertex of the graph nearest to it.
+//	the adjacency is a row of m_adj for each overlay vertex and for each vertex of the graph linked to the overlay,
+//	a linked vertex of the graph has its adjacency of the graph merged with its overlay edges,
+//	the other vertices of the graph are adjacent as in the graph, so LocalMin searches the overlay as a graph.
+//	the linked vertices of the graph are indexed sparsely, sorted by vertex, an overlay costs nothing per vertex of the graph.
+//	m_adj is only appended to: a row grows in place into its slack, or is moved to the end of m_adj,
+//	the rows grown are logged, so an overlay updated from this one copies only what was grown since
+class CPGOverlay
+{
+	friend class CPGOverlayGen;
+public:
+	typedef uint32_t vertex_descriptor;
+public:
+	CPGOverlay();
+	void Initialize(const CPGFileMapped* transitions, int n_eefs);
+	// up to n_overlay vertices of n_links links each are updated without allocations but for the adjacency,
+	//	which grows by doubling while the overlay grows
+	void Reserve(int n_overlay, int n_joints, int n_links);
+	// the vertices, the rows and the adjacency grown in src since the last update are copied
+	void Update(const CPGOverlay& src);
+
+	uint32_t N_Base() const
+	{
+		return m_nBase;
+	}
+
+	uint32_t N_Overlay() const
+	{
+		return (uint32_t)m_anchors.size();
+	}
+
+	uint32_t N_Vertices() const
+	{
+		return m_nBase + N_Overlay();
+	}
+
+	bool Contains(vertex_descriptor v) const
+	{
+		return v >= m_nBase;
+	}
+
+	const vertex_descriptor* AdjacentBegin(vertex_descriptor v) const
+	{
+		const Row* row = FindRow(v);
+		return (NULL == row) ? m_transitions->AdjacentBegin(v) : m_adj.data() + row->begin;
+	}
+
+	const vertex_descriptor* AdjacentEnd(vertex_descriptor v) const
+	{
+		const Row* row = FindRow(v);
+		return (NULL == row) ? m_transitions->AdjacentEnd(v) : m_adj.data() + row->end;
+	}
+
+	const TransformArchive& Theta(vertex_descriptor v) const
+	{
+		IKAssert(Contains(v));
+		return m_thetas[v - m_nBase];
+	}
+
+	// NULL without end effectors
+	const _TRANSFORM* Eefs(vertex_descriptor v) const
+	{
+		IKAssert(Contains(v));
+		return (m_nEefs > 0) ? &m_eefs[(std::size_t)(v - m_nBase) * m_nEefs] : NULL;
+	}
+
+	// a vertex of the graph is its own anchor
+	vertex_descriptor Anchor(vertex_descriptor v) const
+	{
+		return Contains(v) ? m_anchors[v - m_nBase] : v;
+	}
+
+private:
+	struct Row
+	{
+		uint32_t begin;
+		uint32_t end;
+	};
+
+	// NULL for a vertex of the graph not linked to the overlay
+	const Row* FindRow(vertex_descriptor v) const
+	{
+		if (Contains(v))
+			return &m_rows[v - m_nBase];
+		auto it_base = std::lower_bound(m_baseIndex.begin(), m_baseIndex.end(), std::make_pair(v, (uint32_t)0));
+		return (m_baseIndex.end() == it_base || it_base->first != v) ? NULL : &m_baseRows[it_base->second];
+	}
+
+	Row* FindRow(vertex_descriptor v)
+	{
+		return const_cast<Row*>(static_cast<const CPGOverlay*>(this)->FindRow(v));
+	}
+
+	void IndexBase(vertex_descriptor v, uint32_t i_base);
+
+private:
+	const CPGFileMapped* m_transitions;
+	uint32_t m_nBase;
+	int m_nEefs;
+	std::vector<TransformArchive> m_thetas;		// [i_overlay], the slots reserved are constructed ahead
+	std::vector<_TRANSFORM> m_eefs;				// [i_overlay][i_eef]
+	std::vector<vertex_descriptor> m_anchors;	// [i_overlay]
+	std::vector<Row> m_rows;					// [i_overlay]
+	std::vector<Row> m_baseRows;				// [i_base]: the linked vertices of the graph in the order they were linked
+	std::vector<vertex_descriptor> m_baseVertices;					// [i_base]
+	std::vector<std::pair<vertex_descriptor, uint32_t>> m_baseIndex;	// (vertex of the graph, i_base) sorted by vertex
+	std::vector<vertex_descriptor> m_adj;
+	std::vector<vertex_descriptor> m_rowsGrown;	// the vertices whose rows grew after they were appended, logged by the generator only
+	std::size_t m_nRowsGrown;					// the log of the source copied by the last update
+};
+
+// the overlay being grown: an insertion appends the row of the new vertex and the edges to its links,
+//	a link to a vertex of the graph not linked yet appends a row with the adjacency of the vertex in the graph,
+//	the overlay is saved into and loaded from a file (.pgo) next to the graph:
+//		[PGO_FILE_HEADER][thetas: _TRANSFORM x n_joints x n_vertices][eefs: _TRANSFORM x n_eefs x n_vertices]
+//		[anchors: uint32_t x n_vertices][n_links: uint32_t x n_vertices][links: uint32_t x sum(n_links)]
+//	the links of an overlay vertex are the vertices it was linked to when it was inserted,
+//	a file saved for another graph or body is not loaded
+#define PGO_FILE_MAGIC		0x4f475048	// "HPGO"
+#define PGO_FILE_VERSION	1
+
+typedef struct _PGO_FILE_HEADER
+{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t n_base;
+	uint32_t n_vertices;
+	uint32_t n_joints;
+	uint32_t n_eefs;
+} PGO_FILE_HEADER;
+
+class CPGOverlayGen
+{
+public:
+	typedef CPGOverlay::vertex_descriptor vertex_descriptor;
+public:
+	void Initialize(const CPGFileMapped* transitions, int n_eefs);
+	// links are vertices of the graph or of the overlay, returns the new vertex
+	vertex_descriptor Insert(const TransformArchive& theta
+							, const _TRANSFORM* eefs
+							, const vertex_descriptor* links
+							, int n_links
+							, vertex_descriptor anchor);
+
+	const CPGOverlay& Overlay() const
+	{
+		return m_overlay;
+	}
+
+	bool Save(const char* filePath) const;
+	bool Load(const char* filePath, int n_joints);
+private:
+	// a row with the room for capacity vertices, returns the begin of the row
+	uint32_t AppendRow(const vertex_descriptor* begin, const vertex_descriptor* end, uint32_t capacity);
+	// a full row is moved to the end of the adjacency with twice its size
+	void AppendEdge(vertex_descriptor v, vertex_descriptor v_n);
+private:
+	CPGOverlay m_overlay;
+	std::vector<uint32_t> m_rowsCap;			// [i_overlay], the end of the slack of a row
+	std::vector<uint32_t> m_baseRowsCap;		// [i_base]
+	std::vector<std::vector<vertex_descriptor>> m_linksInserted;	// [i_overlay], the links given to Insert
+};
@@ -1,49 +1,764 @@
 #include "pch.h"
 #include "PGRuntimeParallel.hpp"
+#include <map>
+
+// the end effectors are identified in the clone by name, eefsClone is empty if any of them is not found
+static bool CloneBody(const CArtiBodyNode* rootBody, const std::vector<CArtiBodyNode*>& eefs, CArtiBodyNode** rootClone, std::vector<CArtiBodyNode*>& eefsClone)
+{
+	if (!CArtiBodyTree::Clone(rootBody, rootClone))
+		return false;
+
+	eefsClone.clear();
+	for (auto eef : eefs)
+	{
+		CArtiBodyNode* eef_clone = NULL;
+		auto onEnterBody = [&](CArtiBodyNode* body)
+			{
+				if (NULL == eef_clone
+					&& 0 == strcmp(body->GetName_c(), eef->GetName_c()))
+					eef_clone = body;
+			};
+		auto onLeaveBody = [](CArtiBodyNode* body)
+			{
+			};
+		CArtiBodyTree::TraverseDFS(*rootClone, onEnterBody, onLeaveBody);
+		if (NULL == eef_clone)
+		{
+			eefsClone.clear();
+			break;
+		}
+		eefsClone.push_back(eef_clone);
+	}
+	return true;
+}
+
+static const int c_spins = 4096;		// the polls of an idle worker before it parks, in the order of 10 microseconds
 
 CThreadPGProj::CThreadPGProj()
 	: m_pg(NULL)
+	, m_index(NULL)
+	, m_proj(NULL)
 	, m_radius(0)
+	, m_indexBudget(0)
+	, m_slack(0)
+	, m_jobSent(0)
+	, m_jobDone(0)
+	, m_parked(false)
+	, m_stop(false)
+	, m_wake_evt(NULL)
 {
 }
 
-void CThreadPGProj::Initialize_main(CPGRuntime* pg, int radius)
+CThreadPGProj::~CThreadPGProj()
+{
+	if (NULL != m_wake_evt)
+		CloseHandle(m_wake_evt);
+}
+
+void CThreadPGProj::Initialize_main(const CPGRuntimeShared* pg, int radius, int indexBudget, int budget_us, std::atomic<uint64_t>* proj)
 {
 	m_pg = pg;
+	m_index = (indexBudget > 0) ? pg->Index() : NULL;
 	m_radius = radius;
+	m_indexBudget = indexBudget;
+	m_proj = proj;
+	m_wake_evt = CreateEvent(NULL
+							, FALSE //auto-reset event
+							, FALSE //initial state is nonsignaled
+							, NULL);
+	IKAssert(NULL != m_wake_evt);
+	m_deadline.Initialize(budget_us);
+	m_search.Initialize(pg->Transitions().N_Vertices());
+	// a quantized joint is off by at most Error_max / 2 in the chordal distance D of a joint,
+	// the bound between 2 quantized postures is off by at most sqrt(n_joints) * Error_max
+	const CPGThetaCompressed& motions = pg->Thetas().Motions();
+	m_slack = motions.Error_max() * sqrt((Real)motions.N_Joints());
 }
 
-void CThreadPGProj::UpdateFKProj_main()
+// the worker is held by the main thread from the pool, it is released by Stop_main
+void CThreadPGProj::Start_main()
 {
-	m_pg->GetRefBodyTheta(m_theta0);
 	Execute_main();
 }
 
+void CThreadPGProj::Stop_main()
+{
+	m_stop.store(true, std::memory_order_seq_cst);
+	SetEvent(m_wake_evt);
+}
+
+void CThreadPGProj::UpdateFKProj_main(CPGRuntime* pg_ik, uint32_t job)
+{
+	Request& req = m_requests.Back_producer();
+	pg_ik->GetRefBodyTheta(req.theta0);
+	req.theta_start = (uint32_t)pg_ik->BasePosture(pg_ik->ActivePosture());	// the workers do not search the overlay
+	req.job = job;
+#if defined PG_STATS
+	req.tick = std::chrono::steady_clock::now();
+#endif
+	m_jobSent = job;
+	m_requests.Publish_producer();
+	// the flag is raised before the worker checks the buffer for the last time, so a parked worker is never missed
+	if (m_parked.exchange(false, std::memory_order_seq_cst))
+		SetEvent(m_wake_evt);
+}
+
+// a finished job is published only if no later job has been published
+void CThreadPGProj::Publish(std::atomic<uint64_t>& proj, uint32_t job, uint32_t theta)
+{
+	uint64_t proj_new = ((uint64_t)job << 32) | (uint64_t)theta;
+	uint64_t proj_old = proj.load(std::memory_order_relaxed);
+	while ((uint32_t)(proj_old >> 32) < job
+		&& !proj.compare_exchange_weak(proj_old, proj_new, std::memory_order_release, std::memory_order_relaxed));
+}
+
 void CThreadPGProj::Run_worker()
+{
+	int n_spins = 0;
+	while (!m_stop.load(std::memory_order_acquire))
+	{
+		if (m_requests.Take_consumer())
+		{
+			Project(m_requests.Front_consumer());
+			n_spins = 0;
+		}
+		else if (n_spins < c_spins)
+		{
+			YieldProcessor();
+			n_spins ++;
+		}
+		else
+		{
+			Park();
+			n_spins = 0;
+		}
+	}
+}
+
+// an event set for a request taken while spinning wakes the worker once more for nothing
+void CThreadPGProj::Park()
+{
+	m_parked.store(true, std::memory_order_seq_cst);
+	if (!m_requests.Fresh_consumer()
+		&& !m_stop.load(std::memory_order_seq_cst))
+		WaitForSingleObject(m_wake_evt, INFINITE);
+	m_parked.store(false, std::memory_order_relaxed);
+}
+
+void CThreadPGProj::Project(const Request& req)
 {
 	int n_errs = 0;
-	auto FK_Err = [&](int pose_id, bool* failed) -> Real
+	bool expired = false;
+	bool timed = m_deadline.Enabled();
+	if (timed)
+		m_deadline.Begin();
+	const CPGFileMapped& transitions = m_pg->Transitions();
+	const CPGThetaRuntime& thetas = m_pg->Thetas();
+	thetas.GetErrRef(req.theta0, m_theta0_ref);
+
+	CPGRuntime::vertex_descriptor theta_start = req.theta_start;
+	if (NULL != m_index)
+	{
+		Real err_nn = (Real)0;
+		CPGRuntime::vertex_descriptor theta_nn = m_index->Nearest(req.theta0, m_theta0_ref, m_indexQuery, m_indexBudget, &err_nn);
+		uint32_t pose_start = transitions.Theta(theta_start);
+		Real err_start = (Real)0;
+		thetas.Error_q(m_theta0_ref, &pose_start, 1, &err_start);
+		if (err_nn < err_start)
+			theta_start = theta_nn;
+	}
+
+	auto FK_Errs = [&](const CPGRuntime::vertex_descriptor* pose_ids, int n_poses, Real* errs, bool* failed) -> int
 		{
-			const TransformArchive& theta_i = m_pg->GetTheta(pose_id);
-			Real err = TransformArchive::Error_q(m_theta0, theta_i);
-			n_errs ++;
-			*failed = (n_errs > m_radius);
-			return err;
+			// the batch is cut where the per-neighbor evaluation fails, a timed search checks the clock per batch
+			int n_batch = timed ? n_poses : std::min(n_poses, m_radius + 1 - n_errs);
+			m_batch.resize(n_batch);
+			for (int i_pose = 0; i_pose < n_batch; i_pose ++)
+				m_batch[i_pose] = transitions.Theta(pose_ids[i_pose]);
+			thetas.Error_q(m_theta0_ref, m_batch.data(), n_batch, errs);
+#ifdef _DEBUG
+			for (int i_pose = 0; i_pose < n_batch; i_pose ++)
+			{
+				thetas.GetTM(m_batch[i_pose], m_theta_i);
+				IKAssert(errs[i_pose] == TransformArchive::Error_q(req.theta0, m_theta_i));
+			}
+#endif
+			n_errs += n_batch;
+			if (timed)
+				*failed = expired = m_deadline.Expired();
+			else
+				*failed = (n_errs > m_radius);
+			return n_batch;
 		};
 
 	auto OnLocalMin = [&](int pose_id)
 		{
 		};
 
-	int theta_min = CPGRuntime::LocalMin(*m_pg, FK_Err, OnLocalMin);
+	int theta_min = transitions.Weighted()
+				? CPGRuntime::LocalMin_bound(transitions, theta_start, m_search, m_slack, FK_Errs, OnLocalMin)
+				: CPGRuntime::LocalMin_batch(transitions, theta_start, m_search, FK_Errs, OnLocalMin);
 	// LOGIKVarErr(LogInfoInt, theta_min);
-	m_pg->SetActivePosture<true>(theta_min, false);
+	Publish(*m_proj, req.job, (uint32_t)theta_min);
+#if defined PG_STATS
+	if (timed)
+	{
+		int64_t us_search = m_deadline.End();
+		PG_STATS_ADD(m_stats, PROJ_EXPIRED, expired);
+		PG_STATS_ADD(m_stats, US_PROJ_SEARCH_TOTAL, us_search);
+		PG_STATS_MAX(m_stats, US_PROJ_SEARCH_MAX, us_search);
+	}
+	uint64_t us_proj = (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - req.tick).count();
+	PG_STATS_ADD(m_stats, PROJECTIONS, 1);
+	PG_STATS_ADD(m_stats, PROJ_EXHAUSTED, (timed ? expired : n_errs > m_radius));
+	PG_STATS_ADD(m_stats, US_PROJ_TOTAL, us_proj);
+	PG_STATS_MAX(m_stats, US_PROJ_MAX, us_proj);
+#endif
+	m_jobDone.store(req.job, std::memory_order_release);
 	// LOGIKVarErr(LogInfoInt, n_errs);
 }
 
+CThreadPGLoad::CThreadPGLoad()
+	: m_rootBody(NULL)
+	, m_index(false)
+	, m_buildEefIndex(false)
+	, m_shared(NULL)
+{
+}
+
+CThreadPGLoad::~CThreadPGLoad()
+{
+	if (NULL != m_shared)
+		CPGRuntimeShared::Release(m_shared);
+	if (NULL != m_rootBody)
+		CArtiBodyTree::Destroy(m_rootBody);
+}
+
+bool CThreadPGLoad::Initialize_main(const char* pgDir, const CArtiBodyNode* rootBody, const std::vector<CArtiBodyNode*>& eefs, bool index, bool eefIndex)
+{
+	m_pgDir = pgDir;
+	m_index = index;
+	m_buildEefIndex = eefIndex;
+	return CloneBody(rootBody, eefs, &m_rootBody, m_eefs);
+}
+
+void CThreadPGLoad::Load_main()
+{
+	Execute_main();
+}
+
+void CThreadPGLoad::Run_worker()
+{
+	if (NULL != m_rootBody)
+		m_shared = CPGRuntimeShared::Acquire(m_pgDir.c_str(), m_rootBody);
+	if (NULL != m_shared && m_index)
+		m_shared->Index();			// the index is built off the main thread as well
+	if (NULL != m_shared && !m_eefs.empty())
+		CPGRuntime::ComputeEefs(m_shared, m_rootBody, m_eefs, m_eefsTheta);
+	if (NULL != m_shared && m_buildEefIndex)
+		m_eefIndex.Build(m_shared->Transitions(), m_eefsTheta, (int)m_eefs.size());
+}
+
+static const int c_nLinks = 8;
+static const Real c_errDup = (Real)0.1;
+
+// the registry of the overlay generators, 1 per shared graph
+struct PGAugment
+{
+	CThreadPool_W32<CThreadPGAugment>* pool;
+	int n_eefs;
+	int refCount;
+};
+
+static std::mutex s_augmentsLock;
+static std::map<const CPGRuntimeShared*, PGAugment> s_augments;
+
+CThreadPGAugment::CThreadPGAugment()
+	: m_pg(NULL)
+	, m_rootBody(NULL)
+	, m_nMax(0)
+	, m_errLink(0)
+	, m_index(NULL)
+	, m_nInserted(0)
+	, m_nDropped(0)
+{
+}
+
+CThreadPGAugment::~CThreadPGAugment()
+{
+	if (NULL != m_rootBody)
+		CArtiBodyTree::Destroy(m_rootBody);
+}
+
+CThreadPool_W32<CThreadPGAugment>* CThreadPGAugment::Acquire(const CPGRuntime* pg_ik, const CArtiBodyNode* rootBody, const std::vector<CArtiBodyNode*>& eefs, int n_max, Real errLink, const char* filePath)
+{
+	std::lock_guard<std::mutex> lock(s_augmentsLock);
+	auto it_augment = s_augments.find(pg_ik->Shared());
+	if (s_augments.end() != it_augment)
+	{
+		if (it_augment->second.n_eefs != pg_ik->N_Eefs())
+			return NULL;
+		it_augment->second.refCount ++;
+		return it_augment->second.pool;
+	}
+
+	bool initialized = true;
+	auto pool = new CThreadPool_W32<CThreadPGAugment>();
+	bool created = pool->Initialize_main(1,
+							[&](CThreadPGAugment* thread)
+								{
+									initialized = thread->Initialize_main(pg_ik, rootBody, eefs, n_max, errLink, filePath);
+								});
+	if (!(created && initialized))
+	{
+		delete pool;
+		return NULL;
+	}
+	s_augments[pg_ik->Shared()] = {pool, pg_ik->N_Eefs(), 1};
+	return pool;
+}
+
+void CThreadPGAugment::Release(const CPGRuntimeShared* pg)
+{
+	std::lock_guard<std::mutex> lock(s_augmentsLock);
+	auto it_augment = s_augments.find(pg);
+	IKAssert(s_augments.end() != it_augment
+		&& 0 < it_augment->second.refCount);
+	if (0 == -- it_augment->second.refCount)
+	{
+		auto pool = it_augment->second.pool;
+		s_augments.erase(it_augment);
+		for (auto worker : pool->WaitForAllReadyThreads_main())
+			worker->Save_main();
+		delete pool;
+	}
+}
+
+bool CThreadPGAugment::Initialize_main(const CPGRuntime* pg_ik, const CArtiBodyNode* rootBody, const std::vector<CArtiBodyNode*>& eefs, int n_max, Real errLink, const char* filePath)
+{
+	m_pg = pg_ik->Shared();
+	m_nMax = n_max;
+	m_errLink = errLink;
+	m_filePath = (NULL != filePath) ? filePath : "";
+	if (!CloneBody(rootBody, eefs, &m_rootBody, m_eefs)
+		|| !m_pg->Thetas().Bind(m_rootBody, m_joints))
+		return false;
+
+	// the overlay has the end effectors of the runtime
+	int n_eefs = pg_ik->N_Eefs();
+	if ((int)m_eefs.size() != n_eefs)
+		return false;
+	m_eefsTheta.resize(n_eefs);
+	m_gen.Initialize(&m_pg->Transitions(), n_eefs);
+	if (!m_filePath.empty())
+		m_gen.Load(m_filePath.c_str(), (int)m_joints.size());
+	return true;
+}
+
+void CThreadPGAugment::Insert_main(CPGRuntime* pg_ik)
+{
+	pg_ik->GetRefBodyTheta(m_theta);
+	Execute_main();
+}
+
+void CThreadPGAugment::Reserve_main(CPGRuntime* pg_ik) const
+{
+	int n_overlay = std::max(m_nMax, (int)m_gen.Overlay().N_Overlay());
+	pg_ik->ReserveOverlay(n_overlay, c_nLinks);
+}
+
+void CThreadPGAugment::Save_main() const
+{
+	LOGIKVar(LogInfoInt, m_nInserted);
+	LOGIKVar(LogInfoInt, m_nDropped);
+	if (!m_filePath.empty()
+		&& m_gen.Overlay().N_Overlay() > 0)
+		m_gen.Save(m_filePath.c_str());
+}
+
+void CThreadPGAugment::Run_worker()
+{
+	const CPGThetaRuntime& thetas = m_pg->Thetas();
+	const CPGOverlay& overlay = m_gen.Overlay();
+	thetas.GetErrRef(m_theta, m_thetaRef);
+
+	m_links.clear();
+	Real err_min = std::numeric_limits<Real>::max();
+	uint32_t v_min = 0;
+	auto Compare = [&](uint32_t v, Real err)
+		{
+			if (err < err_min)
+			{
+				err_min = err;
+				v_min = v;
+			}
+			if (!(err < m_errLink))
+				return;
+			if ((int)m_links.size() < c_nLinks)
+			{
+				m_links.push_back(std::make_pair(err, v));
+				std::push_heap(m_links.begin(), m_links.end());
+			}
+			else if (err < m_links.front().first)
+			{
+				std::pop_heap(m_links.begin(), m_links.end());
+				m_links.back() = std::make_pair(err, v);
+				std::push_heap(m_links.begin(), m_links.end());
+			}
+		};
+
+	// the vertices of the graph are the candidates of the index, the scan is not cut off the main thread
+	if (NULL == m_index)
+		m_index = m_pg->Index();
+	m_nearest.resize(c_nLinks);
+	m_nearestErrs.resize(c_nLinks);
+	int n_nearest = m_index->Nearest(m_theta, m_thetaRef, m_indexQuery, std::numeric_limits<int>::max(), c_nLinks, m_nearest.data(), m_nearestErrs.data());
+	for (int i_nn = 0; i_nn < n_nearest; i_nn ++)
+		Compare(m_nearest[i_nn], m_nearestErrs[i_nn]);
+	for (uint32_t v = overlay.N_Base(); v < overlay.N_Vertices(); v ++)
+		Compare(v, TransformArchive::Error_q(m_theta, overlay.Theta(v)));
+
+	if (m_links.empty()
+		|| err_min < c_errDup * m_errLink)
+	{
+		m_nDropped ++;
+		return;
+	}
+
+	m_linkVertices.clear();
+	for (const auto& link : m_links)
+		m_linkVertices.push_back(link.second);
+
+	CPGThetaRuntime::PoseBody<true>(m_theta, m_joints, m_rootBody);
+	CPGRuntime::SerializeEefs(m_eefs, m_eefsTheta.data());
+	m_gen.Insert(m_theta, m_eefsTheta.data(), m_linkVertices.data(), (int)m_linkVertices.size(), overlay.Anchor(v_min));
+	m_nInserted ++;
+}
+
+// the registry of the projection services, 1 per shared graph
+struct ProjService
+{
+	CThreadPool_W32<CThreadPGProjService>* pool;
+	CThreadPGProjService* service;
+	int refCount;
+};
+
+static std::mutex s_servicesLock;
+static std::map<const CPGRuntimeShared*, ProjService> s_services;
+
+CThreadPGProjService::CThreadPGProjService()
+	: m_pg(NULL)
+	, m_index(NULL)
+	, m_indexBudget(0)
+	, m_parked(false)
+	, m_stop(false)
+	, m_wake_evt(NULL)
+{
+}
+
+CThreadPGProjService::~CThreadPGProjService()
+{
+	IKAssert(m_clients.empty());
+	if (NULL != m_wake_evt)
+		CloseHandle(m_wake_evt);
+}
+
+// the index budget of the first client serves all the clients
+CThreadPGProjService* CThreadPGProjService::Acquire(const CPGRuntimeShared* pg, int indexBudget)
+{
+	std::lock_guard<std::mutex> lock(s_servicesLock);
+	auto it_service = s_services.find(pg);
+	if (s_services.end() != it_service)
+	{
+		it_service->second.refCount ++;
+		return it_service->second.service;
+	}
+
+	auto pool = new CThreadPool_W32<CThreadPGProjService>();
+	bool created = pool->Initialize_main(1,
+							[&](CThreadPGProjService* thread)
+								{
+									thread->Initialize_main(pg, indexBudget);
+								});
+	if (!created)
+	{
+		delete pool;
+		return NULL;
+	}
+	CThreadPGProjService* service = pool->WaitForAllReadyThreads_main()[0];	// held from the pool while running
+	service->Start_main();
+	s_services[pg] = {pool, service, 1};
+	return service;
+}
+
+void CThreadPGProjService::Release(CThreadPGProjService* service)
+{
+	std::lock_guard<std::mutex> lock(s_servicesLock);
+	auto it_service = s_services.find(service->m_pg);
+	IKAssert(s_services.end() != it_service
+		&& 0 < it_service->second.refCount);
+	if (0 == -- it_service->second.refCount)
+	{
+		auto pool = it_service->second.pool;
+		s_services.erase(it_service);
+		service->Stop_main();
+		pool->WaitForAllReadyThreads_main();
+		delete pool;
+	}
+}
+
+void CThreadPGProjService::Initialize_main(const CPGRuntimeShared* pg, int indexBudget)
+{
+	m_pg = pg;
+	m_index = (indexBudget > 0) ? pg->Index() : NULL;
+	m_indexBudget = indexBudget;
+	m_wake_evt = CreateEvent(NULL
+							, FALSE //auto-reset event
+							, FALSE //initial state is nonsignaled
+							, NULL);
+	IKAssert(NULL != m_wake_evt);
+}
+
+void CThreadPGProjService::Start_main()
+{
+	Execute_main();
+}
+
+void CThreadPGProjService::Stop_main()
+{
+	m_stop.store(true, std::memory_order_seq_cst);
+	SetEvent(m_wake_evt);
+}
+
+CThreadPGProjService::Client* CThreadPGProjService::Register_main(int radius, std::atomic<uint64_t>* proj)
+{
+	Client* client = new Client();
+	client->m_proj = proj;
+	client->m_radius = radius;
+	client->m_active = false;
+	client->m_job = 0;
+	client->m_nErrs = 0;
+	client->m_thetaMin = 0;
+	client->m_errMin = 0;
+	client->m_search.Initialize(m_pg->Transitions().N_Vertices());
+	std::lock_guard<std::mutex> lock(m_clientsLock);
+	m_clients.push_back(client);
+	return client;
+}
+
+void CThreadPGProjService::Unregister_main(Client* client)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_clientsLock);
+		auto it_client = std::find(m_clients.begin(), m_clients.end(), client);
+		IKAssert(m_clients.end() != it_client);
+		m_clients.erase(it_client);
+	}
+	delete client;
+}
+
+void CThreadPGProjService::UpdateFKProj_main(Client* client, CPGRuntime* pg_ik, uint32_t job)
+{
+	Client::Request& req = client->m_requests.Back_producer();
+	pg_ik->GetRefBodyTheta(req.theta0);
+	req.theta_start = (uint32_t)pg_ik->BasePosture(pg_ik->ActivePosture());
+	req.job = job;
+#if defined PG_STATS
+	req.tick = std::chrono::steady_clock::now();
+#endif
+	client->m_requests.Publish_producer();
+	if (m_parked.exchange(false, std::memory_order_seq_cst))
+		SetEvent(m_wake_evt);
+}
+
+void CThreadPGProjService::Run_worker()
+{
+	int n_spins = 0;
+	while (!m_stop.load(std::memory_order_acquire))
+	{
+		if (Round())
+			n_spins = 0;
+		else if (n_spins < c_spins)
+		{
+			YieldProcessor();
+			n_spins ++;
+		}
+		else
+		{
+			Park();
+			n_spins = 0;
+		}
+	}
+}
+
+void CThreadPGProjService::Park()
+{
+	m_parked.store(true, std::memory_order_seq_cst);
+	bool pending = false;
+	{
+		std::lock_guard<std::mutex> lock(m_clientsLock);
+		for (auto client : m_clients)
+			pending = pending || client->m_requests.Fresh_consumer();
+	}
+	if (!pending
+		&& !m_stop.load(std::memory_order_seq_cst))
+		WaitForSingleObject(m_wake_evt, INFINITE);
+	m_parked.store(false, std::memory_order_relaxed);
+}
+
+void CThreadPGProjService::Begin(Client* client)
+{
+	const CPGFileMapped& transitions = m_pg->Transitions();
+	const CPGThetaRuntime& thetas = m_pg->Thetas();
+	const Client::Request& req = client->m_requests.Front_consumer();
+	thetas.GetErrRef(req.theta0, client->m_theta0Ref);
+
+	uint32_t theta_start = req.theta_start;
+	uint32_t pose_start = transitions.Theta(theta_start);
+	Real err_start = (Real)0;
+	thetas.Error_q(client->m_theta0Ref, &pose_start, 1, &err_start);
+	if (NULL != m_index)
+	{
+		Real err_nn = (Real)0;
+		uint32_t theta_nn = m_index->Nearest(req.theta0, client->m_theta0Ref, m_indexQuery, m_indexBudget, &err_nn);
+		if (err_nn < err_start)
+		{
+			theta_start = theta_nn;
+			err_start = err_nn;
+		}
+	}
+
+	CPGSearchContext& search = client->m_search;
+	search.Begin();
+	search.Visit(theta_start, err_start);
+	search.Push(theta_start);
+	client->m_thetaMin = theta_start;
+	client->m_errMin = err_start;
+	client->m_nErrs = 1;
+	client->m_job = req.job;
+	client->m_active = true;
+}
+
+void CThreadPGProjService::End(Client* client)
+{
+	CThreadPGProj::Publish(*client->m_proj, client->m_job, client->m_thetaMin);
+	client->m_active = false;
+#if defined PG_STATS
+	const Client::Request& req = client->m_requests.Front_consumer();
+	uint64_t us_proj = (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - req.tick).count();
+	PG_STATS_ADD(client->m_stats, PROJECTIONS, 1);
+	PG_STATS_ADD(client->m_stats, PROJ_EXHAUSTED, (client->m_nErrs > client->m_radius));
+	PG_STATS_ADD(client->m_stats, US_PROJ_TOTAL, us_proj);
+	PG_STATS_MAX(client->m_stats, US_PROJ_MAX, us_proj);
+#endif
+}
+
+// false if no client has a search or a request
+bool CThreadPGProjService::Round()
+{
+	std::lock_guard<std::mutex> lock(m_clientsLock);
+	const CPGFileMapped& transitions = m_pg->Transitions();
+	const CPGThetaRuntime& thetas = m_pg->Thetas();
+	uint32_t n_clients = (uint32_t)m_clients.size();
+	bool busy = false;
+
+	// 1 expansion of each search collects the unvisited neighbors up to the radius
+	m_scores.clear();
+	for (uint32_t i_client = 0; i_client < n_clients; i_client ++)
+	{
+		Client* client = m_clients[i_client];
+		if (!client->m_active)
+		{
+			if (!client->m_requests.Take_consumer())
+				continue;
+			Begin(client);
+		}
+		busy = true;
+
+		CPGSearchContext& search = client->m_search;
+		std::vector<uint32_t>& batch = search.Batch();
+		batch.clear();
+		if (search.Empty()
+			|| client->m_nErrs > client->m_radius)
+		{
+			End(client);
+			continue;
+		}
+
+		uint32_t theta = search.Pop();
+		Real err = search.Err(theta);
+		if (err < client->m_errMin)
+		{
+			client->m_thetaMin = theta;
+			client->m_errMin = err;
+		}
+		for (const uint32_t* it_v_n = transitions.AdjacentBegin(theta)
+			; it_v_n != transitions.AdjacentEnd(theta)
+			; it_v_n ++)
+		{
+			if (!search.Visited(*it_v_n))
+			{
+				search.Visit(*it_v_n, CIKChain::ERROR_MIN);
+				batch.push_back(*it_v_n);
+			}
+		}
+		uint32_t n_batch = (uint32_t)std::min((int)batch.size(), client->m_radius + 1 - client->m_nErrs);
+		batch.resize(n_batch);
+		search.BatchErrs().resize(n_batch);
+		for (uint32_t i_batch = 0; i_batch < n_batch; i_batch ++)
+			m_scores.push_back({transitions.Theta(batch[i_batch]), i_client, i_batch});
+	}
+
+	// the postures in the order of the theta store, each decoded once for the searches scoring it
+	std::sort(m_scores.begin(), m_scores.end()
+			, [](const Score& s_i, const Score& s_j)
+				{
+					return s_i.theta < s_j.theta;
+				});
+	std::size_t n_scores = m_scores.size();
+	for (std::size_t i_score = 0; i_score < n_scores; )
+	{
+		uint32_t theta = m_scores[i_score].theta;
+		std::size_t j_score = i_score;
+		m_refs.clear();
+		for (; j_score < n_scores && theta == m_scores[j_score].theta; j_score ++)
+			m_refs.push_back(&m_clients[m_scores[j_score].i_client]->m_theta0Ref);
+		m_errs.resize(m_refs.size());
+		thetas.Error_q(theta, m_refs.data(), (int)m_refs.size(), m_errs.data());
+		for (std::size_t k_score = i_score; k_score < j_score; k_score ++)
+		{
+			const Score& score = m_scores[k_score];
+			m_clients[score.i_client]->m_search.BatchErrs()[score.i_batch] = m_errs[k_score - i_score];
+		}
+		i_score = j_score;
+	}
+
+	for (auto client : m_clients)
+	{
+		if (!client->m_active)
+			continue;
+		CPGSearchContext& search = client->m_search;
+		const std::vector<uint32_t>& batch = search.Batch();
+		const std::vector<Real>& batch_errs = search.BatchErrs();
+		std::size_t n_batch = batch.size();
+		for (std::size_t i_batch = 0; i_batch < n_batch; i_batch ++)
+		{
+			search.Visit(batch[i_batch], batch_errs[i_batch]);
+			search.Push(batch[i_batch]);
+		}
+		client->m_nErrs += (int)n_batch;
+	}
+	return busy;
+}
 
 CPGRuntimeParallel::CPGRuntimeParallel()
 	: m_pg(NULL)
+	, m_service(NULL)
+	, m_client(NULL)
+	, m_augment(NULL)
+	, m_proj(0)
+	, m_jobs(0)
+	, m_jobApplied(0)
 	, m_radius(0)
 {
 
@@ -51,13 +766,23 @@ CPGRuntimeParallel::CPGRuntimeParallel()
 
 CPGRuntimeParallel::~CPGRuntimeParallel()
 {
+	for (auto worker : m_workers)
+		worker->Stop_main();
+	m_pool.WaitForAllReadyThreads_main();	// the workers are searching the graph held by m_pg
+	if (NULL != m_service)
+	{
+		m_service->Unregister_main(m_client);
+		CThreadPGProjService::Release(m_service);
+	}
+	if (NULL != m_augment)
+		CThreadPGAugment::Release(m_pg->Shared());
 	delete m_pg;
 }
 
-bool CPGRuntimeParallel::Load(const char* pgDir, CArtiBodyNode* rootBody, int radius)
+bool CPGRuntimeParallel::Load(const PGSettings& settings, CArtiBodyNode* rootBody)
 {
 	m_pg = new CPGRuntime();
-	if (!m_pg->Load(pgDir, rootBody))
+	if (!m_pg->Load(settings.dir.c_str(), rootBody))
 	{
 		delete m_pg;
 		m_pg = NULL;
@@ -66,34 +791,116 @@ bool CPGRuntimeParallel::Load(const char* pgDir, CArtiBodyNode* rootBody, int ra
 	else
 	{
 		m_pg->SetActivePosture<false>(0, true);
-		m_pool.Initialize_main(1,
+		m_radius = settings.radius;
+		if (settings.proj_shared)
+		{
+			m_service = CThreadPGProjService::Acquire(m_pg->Shared(), settings.index_us);
+			if (NULL != m_service)
+				m_client = m_service->Register_main(settings.radius, &m_proj);
+			return true;
+		}
+		bool created = m_pool.Initialize_main(std::max(1, settings.proj_concurrency),
 							[&](CThreadPGProj* thread)
 								{
-									thread->Initialize_main(m_pg, radius);
+									thread->Initialize_main(m_pg->Shared(), settings.radius, settings.index_us, settings.budget_us, &m_proj);
 								});
-		m_radius = radius;
+		if (created)
+		{
+			m_workers = m_pool.WaitForAllReadyThreads_main();	// held from the pool while running
+			for (auto worker : m_workers)
+				worker->Start_main();
+		}
 		return true;
 	}
 
 }
 
-void CPGRuntimeParallel::UpdateFKProj()
+bool CPGRuntimeParallel::Augment(const PGSettings& settings, CArtiBodyNode* rootBody, const std::vector<CArtiBodyNode*>& eefs)
 {
-	auto worker = m_pool.WaitForAReadyThread_main(INFINITE);
-	worker->UpdateFKProj_main();
+	IKAssert(NULL == m_augment);
+	std::string filePath;
+	if (settings.augment_save)
+	{
+		fs::path dir_path(settings.dir);
+		std::string filename_overlay(rootBody->GetName_c()); filename_overlay += ".pgo";
+		fs::path path_overlay(dir_path); path_overlay.append(filename_overlay);
+		filePath = path_overlay.u8string();
+	}
+
+	m_augment = CThreadPGAugment::Acquire(m_pg, rootBody, eefs, settings.augment, settings.augment_err, settings.augment_save ? filePath.c_str() : NULL);
+	if (NULL == m_augment)
+		return false;
+
+	// the overlay grown so far, or loaded from the file, is taken before the first search,
+	//	the overlay is taken by the updates without allocations but for the growth of its adjacency
+	auto worker = m_augment->WaitForAReadyThread_main(INFINITE);
+	worker->Reserve_main(m_pg);
+	m_pg->UpdateOverlay(worker->Overlay_main());
+	worker->HoldReadyOn_main();
+	return true;
 }
 
+#if defined PG_STATS
+void CPGRuntimeParallel::Stats(PG_Stats& stats) const
+{
+	m_stats.Accumulate(stats);
+	for (auto worker : m_workers)
+		worker->Stats_main().Accumulate(stats);
+	if (NULL != m_client)
+		m_client->Stats_main().Accumulate(stats);
+}
 
-CPGRuntime* CPGRuntimeParallel::Lock(Locker* locker)
+void CPGRuntimeParallel::ResetStats()
 {
-	*locker = &m_pool.WaitForAllReadyThreads_main();
-	IKAssert(1 == (*locker)->size());
-	return m_pg;
+	m_stats.Reset();
+	for (auto worker : m_workers)
+		worker->Stats_main().Reset();
+	if (NULL != m_client)
+		m_client->Stats_main().Reset();
 }
+#endif
 
-void CPGRuntimeParallel::UnLock(Locker locker)
+void CPGRuntimeParallel::UpdateOverlay(bool solved)
 {
-	for (auto thread_i : (*locker))
-		thread_i->HoldReadyOn_main();
+	if (NULL == m_augment)
+		return;
+	auto worker = m_augment->WaitForAReadyThread_main(0);
+	if (NULL == worker)
+		return;
+#if defined PG_STATS
+	uint32_t n_overlay = m_pg->Overlay().N_Overlay();
+#endif
+	m_pg->UpdateOverlay(worker->Overlay_main());
+	PG_STATS_ADD(m_stats, OVERLAY_TAKEN, m_pg->Overlay().N_Overlay() - n_overlay);
+	if (solved
+		&& !worker->Full_main())
+		worker->Insert_main(m_pg);
+	else
+		worker->HoldReadyOn_main();
+}
+
+// the projection of this frame goes to the service, to an idle worker, or to the busy workers in turn,
+// a busy worker takes the latest of the jobs published to it once it is done
+void CPGRuntimeParallel::UpdateFKProj()
+{
+	if (NULL != m_client)
+	{
+		m_service->UpdateFKProj_main(m_client, m_pg, ++ m_jobs);
+		return;
+	}
+	int n_workers = (int)m_workers.size();
+	if (0 == n_workers)
+		return;
+	uint32_t job = ++ m_jobs;
+	CThreadPGProj* worker = m_workers[job % n_workers];
+	for (int i_worker = 0; i_worker < n_workers; i_worker ++)
+	{
+		if (m_workers[i_worker]->Idle_main())
+		{
+			worker = m_workers[i_worker];
+			break;
+		}
+	}
+	worker->UpdateFKProj_main(m_pg, job);
 }
 
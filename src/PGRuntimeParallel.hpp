@@ -1,61 +1,360 @@
 #pragma once
+#include <atomic>
+#include <mutex>
 #include "PostureGraph.hpp"
 #include "parallel_thread_helper.hpp"
 #include "Transform.hpp"
+#include "PGStats.hpp"
 
+// a projection worker searches the shared read-only graph with its own search context,
+// the result is published into the runtime tagged with the job number.
+//	a worker runs 1 Run_worker from Start_main to Stop_main, taking the requests from a triple buffer:
+//	the main thread publishes the latest request without waiting for the worker, the worker takes it
+//	without waiting for the main thread. an idle worker spins for a while before it parks on an event,
+//	so the main thread calls the system only to wake a parked worker
 class CThreadPGProj : public CThread_W32
 {
 public:
 	CThreadPGProj();
-	void Initialize_main(CPGRuntime* pg, int radius);
-	void UpdateFKProj_main();
+	~CThreadPGProj();
+	void Initialize_main(const CPGRuntimeShared* pg, int radius, int indexBudget, int budget_us, std::atomic<uint64_t>* proj);
+	void Start_main();
+	void Stop_main();
+	// a job is taken with a snapshot of the IK body and the posture to search from,
+	// it replaces the job published and not taken yet
+	void UpdateFKProj_main(CPGRuntime* pg_ik, uint32_t job);
+	bool Idle_main() const
+	{
+		return m_jobDone.load(std::memory_order_acquire) == m_jobSent;
+	}
+	static void Publish(std::atomic<uint64_t>& proj, uint32_t job, uint32_t theta);
+#if defined PG_STATS
+	CPGStats& Stats_main()
+	{
+		return m_stats;
+	}
+#endif
 private:
+	struct Request
+	{
+		TransformArchive theta0;
+		uint32_t theta_start;
+		uint32_t job;
+#if defined PG_STATS
+		std::chrono::steady_clock::time_point tick;		// the request is published
+#endif
+	};
 	virtual void Run_worker();
-	CPGRuntime* volatile m_pg;
-	volatile int m_radius;
-	TransformArchive m_theta0;
+	void Project(const Request& req);
+	void Park();
+	const CPGRuntimeShared* m_pg;
+	const CPGThetaIndex* m_index;		// NULL for the walk only
+	std::atomic<uint64_t>* m_proj;
+	int m_radius;
+	int m_indexBudget;					// in microseconds
+	Real m_slack;						// of the bounds on an edge weighted graph
+	CPGSearchDeadline m_deadline;		// replaces the radius if enabled
+#if defined PG_STATS
+	CPGStats m_stats;
+#endif
+	CPGThetaIndex::Query m_indexQuery;
+	CTripleBuffer<Request> m_requests;
+	uint32_t m_jobSent;					// by the main thread
+	std::atomic<uint32_t> m_jobDone;	// by the worker
+	std::atomic<bool> m_parked;
+	std::atomic<bool> m_stop;
+	HANDLE m_wake_evt;
+	CPGSearchContext m_search;
+	TransformArchive m_theta_i;
+	CPGThetaCompressed::Reference m_theta0_ref;
+	std::vector<uint32_t> m_batch;		// the thetas of a batch of vertices
 };
 
-class CPGRuntimeParallel
+// loads the shared graph of a body on a background thread with a clone of the body,
+// the runtime is created with the loaded graph on the main thread
+class CThreadPGLoad : public CThread_W32
 {
 public:
-	typedef std::vector<CThreadPGProj*>* Locker;
+	CThreadPGLoad();
+	~CThreadPGLoad();
+	bool Initialize_main(const char* pgDir, const CArtiBodyNode* rootBody, const std::vector<CArtiBodyNode*>& eefs, bool index, bool eefIndex);
+	void Load_main();
+	const CPGRuntimeShared* Loaded_main() const
+	{
+		return m_shared;
+	}
+	// the end effectors of the postures computed with the clone, empty if not computed
+	std::vector<_TRANSFORM>& Eefs_main()
+	{
+		return m_eefsTheta;
+	}
+	int N_Eefs_main() const
+	{
+		return (int)m_eefs.size();
+	}
+	// empty if not built
+	CPGEefIndex& EefIndex_main()
+	{
+		return m_eefIndex;
+	}
+private:
+	virtual void Run_worker();
+	std::string m_pgDir;
+	CArtiBodyNode* m_rootBody;
+	std::vector<CArtiBodyNode*> m_eefs;		// the end effectors in the clone
+	std::vector<_TRANSFORM> m_eefsTheta;
+	CPGEefIndex m_eefIndex;
+	bool m_index;
+	bool m_buildEefIndex;
+	const CPGRuntimeShared* volatile m_shared;
+};
+
+// grows the overlay of a graph with the postures solved by the IK, on a background thread:
+//	a posture is compared with the nearest vertices of the graph found by the nearest posture index
+//	and with all the vertices of the overlay by TransformArchive::Error_q,
+//	it is dropped as a duplicate if a vertex is nearer than c_errDup * errLink,
+//	else it is linked to its c_nLinks nearest vertices within errLink, or dropped if there is none.
+//	the end effectors of the posture are computed with a clone of the body.
+//	the generators are registered by the shared graph and released by reference count,
+//	the pipelines of a graph grow 1 overlay with the settings of the first one, it is saved by the last release
+class CThreadPGAugment : public CThread_W32
+{
+public:
+	CThreadPGAugment();
+	~CThreadPGAugment();
+	// NULL if the generator of the graph of pg_ik has other end effectors than pg_ik
+	static CThreadPool_W32<CThreadPGAugment>* Acquire(const CPGRuntime* pg_ik, const CArtiBodyNode* rootBody, const std::vector<CArtiBodyNode*>& eefs, int n_max, Real errLink, const char* filePath);
+	static void Release(const CPGRuntimeShared* pg);
+	// the overlay saved in filePath is loaded if it is of the same graph and body, NULL filePath for no file
+	bool Initialize_main(const CPGRuntime* pg_ik, const CArtiBodyNode* rootBody, const std::vector<CArtiBodyNode*>& eefs, int n_max, Real errLink, const char* filePath);
+	// the posture of the body bound to pg_ik is inserted
+	void Insert_main(CPGRuntime* pg_ik);
+	void Save_main() const;
+	// the overlay of pg_ik is reserved for the overlay of this generator at its full size
+	void Reserve_main(CPGRuntime* pg_ik) const;
+	// read by the main thread only while the worker is held ready
+	const CPGOverlay& Overlay_main() const
+	{
+		return m_gen.Overlay();
+	}
+	bool Full_main() const
+	{
+		return (int)m_gen.Overlay().N_Overlay() >= m_nMax;
+	}
+private:
+	virtual void Run_worker();
+	const CPGRuntimeShared* m_pg;
+	CArtiBodyNode* m_rootBody;
+	std::vector<IJoint*> m_joints;				// of the clone, bound to the postures
+	std::vector<CArtiBodyNode*> m_eefs;			// the end effectors in the clone
+	int m_nMax;
+	Real m_errLink;
+	std::string m_filePath;						// empty for not persisted
+	CPGOverlayGen m_gen;
+	TransformArchive m_theta;
+	CPGThetaCompressed::Reference m_thetaRef;
+	const CPGThetaIndex* m_index;				// built by the first insertion
+	CPGThetaIndex::Query m_indexQuery;
+	std::vector<uint32_t> m_nearest;
+	std::vector<Real> m_nearestErrs;
+	std::vector<std::pair<Real, uint32_t>> m_links;	// max-heap of (error, vertex) of the nearest vertices within m_errLink
+	std::vector<uint32_t> m_linkVertices;
+	std::vector<_TRANSFORM> m_eefsTheta;
+	int m_nInserted;
+	int m_nDropped;
+};
+
+// the projection service of a graph shared by the pipelines that opt in, instead of a pool of workers per pipeline:
+//	a client publishes its latest job into a triple buffer as it does to a projection worker,
+//	1 service thread walks the searches of all the clients in lockstep, 1 expansion of each search a round,
+//	and scores the neighbors collected by the round in 1 pass over the theta store:
+//	the (posture, search) pairs are sorted by posture, a posture is decoded once for all the searches scoring it.
+//	a search expands the vertices as LocalMin_batch does and stops at the radius of its client,
+//	its result is published into the active posture slot of the client as a projection worker does.
+//	the services are registered by the shared graph and released by reference count
+class CThreadPGProjService : public CThread_W32
+{
+public:
+	class Client
+	{
+		friend class CThreadPGProjService;
+		struct Request
+		{
+			TransformArchive theta0;
+			uint32_t theta_start;
+			uint32_t job;
+#if defined PG_STATS
+			std::chrono::steady_clock::time_point tick;		// the request is published
+#endif
+		};
+	public:
+#if defined PG_STATS
+		CPGStats& Stats_main()
+		{
+			return m_stats;
+		}
+#endif
+	private:
+		CTripleBuffer<Request> m_requests;
+		std::atomic<uint64_t>* m_proj;
+		int m_radius;
+		// the search in progress, by the service
+		bool m_active;
+		uint32_t m_job;
+		int m_nErrs;
+		uint32_t m_thetaMin;
+		Real m_errMin;
+		CPGSearchContext m_search;
+		CPGThetaCompressed::Reference m_theta0Ref;
+#if defined PG_STATS
+		CPGStats m_stats;
+#endif
+	};
+
+public:
+	CThreadPGProjService();
+	~CThreadPGProjService();
+	// the service of the first caller of a graph decides whether the projections start from the index
+	static CThreadPGProjService* Acquire(const CPGRuntimeShared* pg, int indexBudget);
+	static void Release(CThreadPGProjService* service);
+	Client* Register_main(int radius, std::atomic<uint64_t>* proj);
+	// the search in progress of the client is dropped
+	void Unregister_main(Client* client);
+	void UpdateFKProj_main(Client* client, CPGRuntime* pg_ik, uint32_t job);
+private:
+	void Initialize_main(const CPGRuntimeShared* pg, int indexBudget);
+	void Start_main();
+	void Stop_main();
+	virtual void Run_worker();
+	bool Round();
+	void Begin(Client* client);
+	void End(Client* client);
+	void Park();
+
+	struct Score
+	{
+		uint32_t theta;
+		uint32_t i_client;
+		uint32_t i_batch;
+	};
+	const CPGRuntimeShared* m_pg;
+	const CPGThetaIndex* m_index;		// NULL for the walk only
+	int m_indexBudget;
+	CPGThetaIndex::Query m_indexQuery;
+	std::mutex m_clientsLock;			// held by a round, by the registration of a client
+	std::vector<Client*> m_clients;
+	std::atomic<bool> m_parked;
+	std::atomic<bool> m_stop;
+	HANDLE m_wake_evt;
+	std::vector<Score> m_scores;
+	std::vector<CPGThetaCompressed::Reference*> m_refs;
+	std::vector<Real> m_errs;
+};
+
+// the posture graph settings of a group, the PG_* attributes of the body configuration
+struct PGSettings
+{
+	std::string dir;
+	int radius;
+	int proj_concurrency;
+	bool proj_shared;			// the projections go to the projection service of the graph
+	int index_us;
+	int knn;					// the number of restarts seeded by the task space index, 0 for none
+	int budget_us;				// in microseconds per search and per projection, 0 for the radius
+	Real resume_dist;			// the search is resumed if no goal moved further, 0 for no resuming
+	int augment;				// the maximum number of postures grown into the overlay, 0 for no augmentation
+	Real augment_err;
+	bool augment_save;
+	bool async;
+	PGSettings()
+		: radius(0)
+		, proj_concurrency(1)
+		, proj_shared(false)
+		, index_us(0)
+		, knn(0)
+		, budget_us(0)
+		, resume_dist(0)
+		, augment(0)
+		, augment_err(0)
+		, augment_save(false)
+		, async(false)
+	{
+	}
+};
+
+// the IK search runs on the main thread with the runtime m_pg,
+// the FK projections run on a pool of workers, none of them blocks the main thread:
+//	a projection is dispatched to an idle worker, or it replaces the job not taken yet of a busy worker in turn,
+//	the latest projected posture is published as (job << 32 | theta) and picked up by ApplyActivePosture.
+//	with a positive index_us, a projection starts from the nearest posture of the whole graph
+//	found by the index within index_us microseconds if it is nearer than the active posture.
+//	with a positive budget_us, a projection stops at its deadline instead of at radius evaluations.
+//	with Augment, the postures solved by the IK are grown into the overlay by the generator shared by the pipelines of the graph,
+//	the main thread takes the grown overlay when the worker is ready, the projections search the graph only
+//	with proj_shared, the projections go to the projection service of the graph instead of the workers,
+//	the service ignores budget_us and the edge weights
+class CPGRuntimeParallel
+{
 public:
 	CPGRuntimeParallel();
 	~CPGRuntimeParallel();
-	bool Load(const char* pgDir, CArtiBodyNode* rootBody, int radius);
+	bool Load(const PGSettings& settings, CArtiBodyNode* rootBody);
+	// at most settings.augment postures are grown into the overlay, linked by the edges of errors within augment_err,
+	// with augment_save, the overlay is loaded from and saved into <dir>/<root name>.pgo
+	bool Augment(const PGSettings& settings, CArtiBodyNode* rootBody, const std::vector<CArtiBodyNode*>& eefs);
 	void UpdateFKProj();
+	// once per update between 2 searches: the grown overlay is taken and a solved posture is passed on if the worker is ready
+	void UpdateOverlay(bool solved);
 
 	template<bool G_SPACE>
 	void ApplyActivePosture()
 	{
-		auto& workers = m_pool.WaitForAllReadyThreads_main(); // make sure no worker threads working
-		IKAssert(1 == workers.size());
+		uint64_t proj = m_proj.load(std::memory_order_acquire);
+		uint32_t job = (uint32_t)(proj >> 32);
+		if (job > m_jobApplied)
+		{
+			m_jobApplied = job;
+			int pose_id_m = m_pg->SetActivePosture<G_SPACE>((int)(proj & 0xffffffff), false);
+			PG_STATS_ADD(m_stats, POSTURE_CHANGES, (pose_id_m != m_pg->ActivePosture()));
+		}
 		m_pg->ApplyActivePosture<G_SPACE>();
-		for (auto worker_i : workers)
-			worker_i->HoldReadyOn_main();
 	}
 
 	template<bool G_SPACE>
 	int SetActivePosture(int pose_id, bool UpdatePose)
 	{
-		auto& workers = m_pool.WaitForAllReadyThreads_main();
-		IKAssert(1 == workers.size());
-		int pose_id_ret = m_pg->SetActivePosture<G_SPACE>(pose_id, UpdatePose);
-		for (auto worker_i : workers)
-			worker_i->HoldReadyOn_main();
-		return pose_id_ret;
+		m_jobApplied = m_jobs;		// the projections in flight are discarded
+		return m_pg->SetActivePosture<G_SPACE>(pose_id, UpdatePose);
 	}
 
-	CPGRuntime* Lock(Locker* locker);
-	void UnLock(Locker locker);
+	// the runtime is owned by the main thread, the workers never touch it
+	CPGRuntime* Runtime()
+	{
+		return m_pg;
+	}
 
 	int Radius() const
 	{
 		return m_radius;
 	}
+
+#if defined PG_STATS
+	// the counters of the main thread and of the workers
+	void Stats(PG_Stats& stats) const;
+	void ResetStats();
+#endif
 private:
 	CPGRuntime* m_pg;
 	CThreadPool_W32<CThreadPGProj> m_pool;
+	std::vector<CThreadPGProj*> m_workers;		// running from Load to the destruction
+	CThreadPGProjService* m_service;			// NULL for the workers
+	CThreadPGProjService::Client* m_client;
+	CThreadPool_W32<CThreadPGAugment>* m_augment;	// the generator of the graph, NULL if the graph is not augmented
+	std::atomic<uint64_t> m_proj;
+	uint32_t m_jobs;
+	uint32_t m_jobApplied;
 	int m_radius;
-};
\ No newline at end of file
+#if defined PG_STATS
+	CPGStats m_stats;
+#endif
+};
@@ -0,0 +1,119 @@
+#pragma once
+#include <stdint.h>
+#include <atomic>
+#include "motion_pipeline.h"
+
+// the counters of the posture graph of a group, compiled out without PG_STATS:
+//	a block of counters is written by 1 thread only, the main thread or a projection worker,
+//	with relaxed atomics, so the main thread reads any block at any time without a lock.
+//	a reset is a request taken by the writing thread on its next count, until then the block reads 0
+#if defined PG_STATS
+#	define PG_STATS_ADD(stats, counter, n)	(stats).Add(CPGStats::counter, (uint64_t)(n))
+#	define PG_STATS_MAX(stats, counter, n)	(stats).Max(CPGStats::counter, (uint64_t)(n))
+#else
+#	define PG_STATS_ADD(stats, counter, n)
+#	define PG_STATS_MAX(stats, counter, n)
+#endif
+
+#if defined PG_STATS
+class CPGStats
+{
+public:
+	enum Counter
+	{
+		SEARCHES = 0,
+		ERRS,
+		LOCAL_MINIMA,
+		RESTARTS,
+		EXHAUSTED,
+		EXPIRED,
+		US_SEARCH_TOTAL,
+		US_SEARCH_MAX,
+		POSTURE_CHANGES,
+		PROJECTIONS,
+		PROJ_EXHAUSTED,
+		PROJ_EXPIRED,
+		US_PROJ_SEARCH_TOTAL,
+		US_PROJ_SEARCH_MAX,
+		US_PROJ_TOTAL,
+		US_PROJ_MAX,
+		OVERLAY_TAKEN,
+		N_COUNTERS
+	};
+public:
+	CPGStats()
+		: m_reset(false)
+	{
+		for (auto& counter : m_counters)
+			counter.store(0, std::memory_order_relaxed);
+	}
+
+	// by the writing thread
+	void Add(Counter c, uint64_t n)
+	{
+		Sync();
+		m_counters[c].store(m_counters[c].load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+	}
+
+	void Max(Counter c, uint64_t n)
+	{
+		Sync();
+		if (n > m_counters[c].load(std::memory_order_relaxed))
+			m_counters[c].store(n, std::memory_order_relaxed);
+	}
+
+	// by the main thread
+	void Reset()
+	{
+		m_reset.store(true, std::memory_order_release);
+	}
+
+	void Accumulate(PG_Stats& stats) const
+	{
+		if (m_reset.load(std::memory_order_acquire))
+			return;
+		stats.n_searches += Get(SEARCHES);
+		stats.n_errs += Get(ERRS);
+		stats.n_localMinima += Get(LOCAL_MINIMA);
+		stats.n_restarts += Get(RESTARTS);
+		stats.n_exhausted += Get(EXHAUSTED);
+		stats.n_expired += Get(EXPIRED);
+		stats.us_searchTotal += Get(US_SEARCH_TOTAL);
+		if (Get(US_SEARCH_MAX) > stats.us_searchMax)
+			stats.us_searchMax = Get(US_SEARCH_MAX);
+		stats.n_postureChanges += Get(POSTURE_CHANGES);
+		stats.n_projections += Get(PROJECTIONS);
+		stats.n_projExhausted += Get(PROJ_EXHAUSTED);
+		stats.n_projExpired += Get(PROJ_EXPIRED);
+		stats.us_projSearchTotal += Get(US_PROJ_SEARCH_TOTAL);
+		if (Get(US_PROJ_SEARCH_MAX) > stats.us_projSearchMax)
+			stats.us_projSearchMax = Get(US_PROJ_SEARCH_MAX);
+		stats.us_projTotal += Get(US_PROJ_TOTAL);
+		if (Get(US_PROJ_MAX) > stats.us_projMax)
+			stats.us_projMax = Get(US_PROJ_MAX);
+		stats.n_overlayTaken += Get(OVERLAY_TAKEN);
+	}
+
+private:
+	void Sync()
+	{
+		// the request is taken before the counters are zeroed, a reset requested meanwhile is kept for the next count,
+		// the exchange is paid only with a request pending
+		if (m_reset.load(std::memory_order_relaxed)
+			&& m_reset.exchange(false, std::memory_order_acq_rel))
+		{
+			for (auto& counter : m_counters)
+				counter.store(0, std::memory_order_relaxed);
+		}
+	}
+
+	uint64_t Get(Counter c) const
+	{
+		return m_counters[c].load(std::memory_order_relaxed);
+	}
+
+private:
+	std::atomic<uint64_t> m_counters[N_COUNTERS];
+	std::atomic<bool> m_reset;
+};
+#endif
@@ -0,0 +1,371 @@
+#include "pch.h"
+#include <math.h>
+#include <algorithm>
+#include "PGThetaCompressed.hpp"
+
+#if defined _M_X64 || defined _M_IX86 || defined __SSE2__
+#	include <emmintrin.h>
+#	define PG_THETA_SSE2
+#endif
+
+#define N_BATCH 8
+
+// [-1/sqrt(2), 1/sqrt(2)] <-> [-32767, 32767]
+static const Real c_quantize = (Real)(32767.0 * 1.41421356237309504880);
+static const Real c_dequantize = (Real)1 / c_quantize;
+
+// the component index in {w, x, y, z} of a, b, c for the dropped (largest) component
+static const int c_abc2wxyz[4][3] = {
+	{1, 2, 3},
+	{0, 2, 3},
+	{0, 1, 3},
+	{0, 1, 2}
+};
+
+CPGThetaCompressed::CPGThetaCompressed()
+	: m_nThetas(0)
+	, m_nJoints(0)
+	, m_nRotPad(0)
+	, m_errMax(0)
+{
+}
+
+void CPGThetaCompressed::Encode(const _ROT& r, int16_t* a, int16_t* b, int16_t* c, int16_t* i_max)
+{
+	Real q[4] = {r.w, r.x, r.y, r.z};
+	Real norm = sqrt(q[0]*q[0] + q[1]*q[1] + q[2]*q[2] + q[3]*q[3]);
+	IKAssert(norm > (Real)0);
+	int i_m = 0;
+	for (int i_q = 1; i_q < 4; i_q ++)
+	{
+		if (fabs(q[i_q]) > fabs(q[i_m]))
+			i_m = i_q;
+	}
+	// q and -q are the same rotation, the dropped component is kept positive
+	Real scale = (q[i_m] < 0 ? -c_quantize : c_quantize) / norm;
+	int16_t* abc[] = {a, b, c};
+	const int* slots = c_abc2wxyz[i_m];
+	for (int i_abc = 0; i_abc < 3; i_abc ++)
+	{
+		Real v = q[slots[i_abc]] * scale;
+		v = std::max((Real)-32767, std::min((Real)32767, v));
+		*abc[i_abc] = (int16_t)floor(v + (Real)0.5);
+	}
+	*i_max = (int16_t)i_m;
+}
+
+void CPGThetaCompressed::Initialize(const std::vector<TransformArchive>& thetas)
+{
+	m_nThetas = (int)thetas.size();
+	m_nJoints = (m_nThetas > 0) ? (int)thetas[0].Size() : 0;
+	m_rotJoints.clear();
+	m_fullJoints.clear();
+	for (int i_joint = 0; i_joint < m_nJoints; i_joint ++)
+	{
+		bool rot_only = true;
+		for (int i_theta = 0; i_theta < m_nThetas && rot_only; i_theta ++)
+		{
+			const _TRANSFORM& tm = thetas[i_theta][i_joint];
+			rot_only = (NoTT(tm) && NoScale(tm));
+		}
+		if (rot_only)
+			m_rotJoints.push_back(i_joint);
+		else
+			m_fullJoints.push_back(i_joint);
+	}
+
+	int n_rots = (int)m_rotJoints.size();
+	int n_fulls = (int)m_fullJoints.size();
+	m_nRotPad = ((n_rots + N_BATCH - 1) / N_BATCH) * N_BATCH;
+	m_rotData.assign((std::size_t)m_nThetas * (std::size_t)m_nRotPad * 4, 0);
+	m_fullData.resize((std::size_t)m_nThetas * (std::size_t)n_fulls);
+
+	TransformArchive theta_prime;
+	m_errMax = 0;
+	for (int i_theta = 0; i_theta < m_nThetas; i_theta ++)
+	{
+		const TransformArchive& theta_i = thetas[i_theta];
+		int16_t* a = &m_rotData[(std::size_t)i_theta * (std::size_t)m_nRotPad * 4];
+		int16_t* b = a + m_nRotPad;
+		int16_t* c = b + m_nRotPad;
+		int16_t* i_max = c + m_nRotPad;
+		for (int i_rot = 0; i_rot < n_rots; i_rot ++)
+			Encode(theta_i[m_rotJoints[i_rot]].r, a + i_rot, b + i_rot, c + i_rot, i_max + i_rot);
+		_TRANSFORM* fulls = m_fullData.data() + (std::size_t)i_theta * (std::size_t)n_fulls;
+		for (int i_full = 0; i_full < n_fulls; i_full ++)
+			fulls[i_full] = theta_i[m_fullJoints[i_full]];
+
+		Decode(i_theta, theta_prime);
+		for (int i_rot = 0; i_rot < n_rots; i_rot ++)
+		{
+			const _ROT& r = theta_i[m_rotJoints[i_rot]].r;
+			const _ROT& r_prime = theta_prime[m_rotJoints[i_rot]].r;
+			double norm = sqrt((double)r.w*r.w + (double)r.x*r.x + (double)r.y*r.y + (double)r.z*r.z);
+			double dot = fabs((double)r.w*r_prime.w + (double)r.x*r_prime.x + (double)r.y*r_prime.y + (double)r.z*r_prime.z) / norm;
+			Real err = (Real)(2.0 * acos(std::min(1.0, dot)));
+			m_errMax = std::max(m_errMax, err);
+		}
+	}
+
+	int kb_raw = (int)(((std::size_t)m_nThetas * ((std::size_t)m_nJoints * sizeof(_TRANSFORM) + sizeof(TransformArchive))) >> 10);
+	int kb_compressed = (int)(Bytes() >> 10);
+	LOGIKVar(LogInfoInt, n_rots);
+	LOGIKVar(LogInfoInt, n_fulls);
+	LOGIKVar(LogInfoInt, kb_raw);
+	LOGIKVar(LogInfoInt, kb_compressed);
+	LOGIKVar(LogInfoReal, m_errMax);
+}
+
+void CPGThetaCompressed::Decode(int i_theta, TransformArchive& theta) const
+{
+	IKAssert(-1 < i_theta && i_theta < m_nThetas);
+	if ((int)theta.Size() != m_nJoints)
+		theta.Resize(m_nJoints);
+	DecodeRotations(&m_rotData[(std::size_t)i_theta * (std::size_t)m_nRotPad * 4], theta);
+	int n_fulls = (int)m_fullJoints.size();
+	const _TRANSFORM* fulls = m_fullData.data() + (std::size_t)i_theta * (std::size_t)n_fulls;
+	for (int i_full = 0; i_full < n_fulls; i_full ++)
+		theta[m_fullJoints[i_full]] = fulls[i_full];
+}
+
+// a batch of N_BATCH joints is dequantized and the dropped component is recovered with SIMD,
+// the components are then placed into {w, x, y, z} by the dropped component index
+void CPGThetaCompressed::DecodeRotations(const int16_t* rots, TransformArchive& theta) const
+{
+	const int16_t* a = rots;
+	const int16_t* b = a + m_nRotPad;
+	const int16_t* c = b + m_nRotPad;
+	const int16_t* i_max = c + m_nRotPad;
+	int n_rots = (int)m_rotJoints.size();
+
+	alignas(16) Real f_a[N_BATCH];
+	alignas(16) Real f_b[N_BATCH];
+	alignas(16) Real f_c[N_BATCH];
+	alignas(16) Real f_d[N_BATCH];
+
+	for (int i_base = 0; i_base < n_rots; i_base += N_BATCH)
+	{
+#if defined PG_THETA_SSE2
+		const __m128 dequantize = _mm_set1_ps(c_dequantize);
+		const __m128 one = _mm_set1_ps(1.0f);
+		const __m128 zero = _mm_setzero_ps();
+		const int16_t* src[] = {a + i_base, b + i_base, c + i_base};
+		Real* dst[] = {f_a, f_b, f_c};
+		__m128 sqr_sum[2] = {zero, zero};
+		for (int i_abc = 0; i_abc < 3; i_abc ++)
+		{
+			__m128i v_16 = _mm_loadu_si128((const __m128i*)src[i_abc]);
+			__m128i v_32[2] = {
+				_mm_srai_epi32(_mm_unpacklo_epi16(v_16, v_16), 16),
+				_mm_srai_epi32(_mm_unpackhi_epi16(v_16, v_16), 16)
+			};
+			for (int i_half = 0; i_half < 2; i_half ++)
+			{
+				__m128 v = _mm_mul_ps(_mm_cvtepi32_ps(v_32[i_half]), dequantize);
+				_mm_store_ps(dst[i_abc] + 4 * i_half, v);
+				sqr_sum[i_half] = _mm_add_ps(sqr_sum[i_half], _mm_mul_ps(v, v));
+			}
+		}
+		for (int i_half = 0; i_half < 2; i_half ++)
+			_mm_store_ps(f_d + 4 * i_half, _mm_sqrt_ps(_mm_max_ps(zero, _mm_sub_ps(one, sqr_sum[i_half]))));
+#else
+		for (int i_b = 0; i_b < N_BATCH; i_b ++)
+		{
+			f_a[i_b] = (Real)a[i_base + i_b] * c_dequantize;
+			f_b[i_b] = (Real)b[i_base + i_b] * c_dequantize;
+			f_c[i_b] = (Real)c[i_base + i_b] * c_dequantize;
+			Real sqr_sum = f_a[i_b] * f_a[i_b] + f_b[i_b] * f_b[i_b] + f_c[i_b] * f_c[i_b];
+			f_d[i_b] = sqrt(std::max((Real)0, (Real)1 - sqr_sum));
+		}
+#endif
+		int n_b = std::min(N_BATCH, n_rots - i_base);
+		for (int i_b = 0; i_b < n_b; i_b ++)
+		{
+			int i_m = i_max[i_base + i_b];
+			const int* slots = c_abc2wxyz[i_m];
+			_TRANSFORM& tm = theta[m_rotJoints[i_base + i_b]];
+			Real* wxyz = &tm.r.w;
+			wxyz[i_m] = f_d[i_b];
+			wxyz[slots[0]] = f_a[i_b];
+			wxyz[slots[1]] = f_b[i_b];
+			wxyz[slots[2]] = f_c[i_b];
+			tm.s.x = (Real)1; tm.s.y = (Real)1; tm.s.z = (Real)1;
+			tm.tt.x = (Real)0; tm.tt.y = (Real)0; tm.tt.z = (Real)0;
+		}
+	}
+}
+
+void CPGThetaCompressed::SetReference(const TransformArchive& theta, Reference& ref) const
+{
+	ref.m_nJoints = (int)theta.Size();
+	ref.m_terms.resize(ref.m_nJoints);
+	if (ref.m_nJoints != m_nJoints)
+		return;
+	int n_rots = (int)m_rotJoints.size();
+	ref.m_rots.assign((std::size_t)m_nRotPad * 4, (Real)0);
+	Real* wxyz[] = {
+		ref.m_rots.data(),
+		ref.m_rots.data() + m_nRotPad,
+		ref.m_rots.data() + 2 * m_nRotPad,
+		ref.m_rots.data() + 3 * m_nRotPad
+	};
+	for (int i_rot = 0; i_rot < n_rots; i_rot ++)
+	{
+		const _ROT& r = theta[m_rotJoints[i_rot]].r;
+		wxyz[0][i_rot] = r.w;
+		wxyz[1][i_rot] = r.x;
+		wxyz[2][i_rot] = r.y;
+		wxyz[3][i_rot] = r.z;
+	}
+	int n_fulls = (int)m_fullJoints.size();
+	ref.m_fulls.resize(n_fulls);
+	for (int i_full = 0; i_full < n_fulls; i_full ++)
+		ref.m_fulls[i_full] = theta[m_fullJoints[i_full]].r;
+}
+
+// the error terms of the rotation-only joints are computed 4 joints a time without decoding a posture,
+//	the operations are the ones of DecodeRotations and TransformArchive::Error_q in the same order,
+//	and the terms are summed up in the joint order, thus the error is exactly the one of the decoded posture
+void CPGThetaCompressed::Error_q(Reference& ref, const uint32_t* i_thetas, int n_thetas, Real* errs) const
+{
+	if (ref.m_nJoints != m_nJoints)
+	{
+		for (int i_err = 0; i_err < n_thetas; i_err ++)
+			errs[i_err] = (Real)ref.m_nJoints;
+		return;
+	}
+
+	Reference* refs[] = {&ref};
+	for (int i_err = 0; i_err < n_thetas; i_err ++)
+	{
+#if defined PG_THETA_SSE2
+		if (i_err + 1 < n_thetas)
+			_mm_prefetch((const char*)&m_rotData[(std::size_t)i_thetas[i_err + 1] * (std::size_t)m_nRotPad * 4], _MM_HINT_T0);
+#endif
+		Error_q(i_thetas[i_err], refs, 1, errs + i_err);
+	}
+}
+
+// the rotations of a posture are recovered once, 4 joints a time, and scored against all the references
+void CPGThetaCompressed::Error_q(uint32_t i_theta, Reference* const* refs, int n_refs, Real* errs) const
+{
+	IKAssert((int)i_theta < m_nThetas);
+	int n_rots = (int)m_rotJoints.size();
+	int n_fulls = (int)m_fullJoints.size();
+	const int16_t* a = &m_rotData[(std::size_t)i_theta * (std::size_t)m_nRotPad * 4];
+	const int16_t* b = a + m_nRotPad;
+	const int16_t* c = b + m_nRotPad;
+	const int16_t* i_max = c + m_nRotPad;
+
+#if defined PG_THETA_SSE2
+	alignas(16) Real f_terms[4];
+	const __m128 dequantize = _mm_set1_ps(c_dequantize);
+	const __m128 one = _mm_set1_ps(1.0f);
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 sign = _mm_set1_ps(-0.0f);
+	auto Load = [](const int16_t* v) -> __m128i
+		{
+			__m128i v_16 = _mm_loadl_epi64((const __m128i*)v);
+			return _mm_srai_epi32(_mm_unpacklo_epi16(v_16, v_16), 16);
+		};
+	auto Select = [](__m128 mask, __m128 v_true, __m128 v_false) -> __m128
+		{
+			return _mm_or_ps(_mm_and_ps(mask, v_true), _mm_andnot_ps(mask, v_false));
+		};
+	for (int i_base = 0; i_base < n_rots; i_base += 4)
+	{
+		__m128 f_a = _mm_mul_ps(_mm_cvtepi32_ps(Load(a + i_base)), dequantize);
+		__m128 f_b = _mm_mul_ps(_mm_cvtepi32_ps(Load(b + i_base)), dequantize);
+		__m128 f_c = _mm_mul_ps(_mm_cvtepi32_ps(Load(c + i_base)), dequantize);
+		__m128 sqr_sum = _mm_add_ps(zero, _mm_mul_ps(f_a, f_a));
+		sqr_sum = _mm_add_ps(sqr_sum, _mm_mul_ps(f_b, f_b));
+		sqr_sum = _mm_add_ps(sqr_sum, _mm_mul_ps(f_c, f_c));
+		__m128 f_d = _mm_sqrt_ps(_mm_max_ps(zero, _mm_sub_ps(one, sqr_sum)));
+
+		__m128i i_m = Load(i_max + i_base);
+		__m128 is_w = _mm_castsi128_ps(_mm_cmpeq_epi32(i_m, _mm_set1_epi32(0)));
+		__m128 is_x = _mm_castsi128_ps(_mm_cmpeq_epi32(i_m, _mm_set1_epi32(1)));
+		__m128 is_y = _mm_castsi128_ps(_mm_cmpeq_epi32(i_m, _mm_set1_epi32(2)));
+		__m128 is_z = _mm_castsi128_ps(_mm_cmpeq_epi32(i_m, _mm_set1_epi32(3)));
+		// {w, x, y, z} by c_abc2wxyz
+		__m128 q_w = Select(is_w, f_d, f_a);
+		__m128 q_x = Select(is_w, f_a, Select(is_x, f_d, f_b));
+		__m128 q_y = Select(is_y, f_d, Select(is_z, f_c, f_b));
+		__m128 q_z = Select(is_z, f_d, f_c);
+
+		int n_b = std::min(4, n_rots - i_base);
+		for (int i_ref = 0; i_ref < n_refs; i_ref ++)
+		{
+			Reference& ref = *refs[i_ref];
+			IKAssert(ref.m_nJoints == m_nJoints);
+			const Real* r_w = ref.m_rots.data();
+			const Real* r_x = r_w + m_nRotPad;
+			const Real* r_y = r_x + m_nRotPad;
+			const Real* r_z = r_y + m_nRotPad;
+			__m128 dot = _mm_mul_ps(_mm_loadu_ps(r_w + i_base), q_w);
+			dot = _mm_add_ps(dot, _mm_mul_ps(_mm_loadu_ps(r_x + i_base), q_x));
+			dot = _mm_add_ps(dot, _mm_mul_ps(_mm_loadu_ps(r_y + i_base), q_y));
+			dot = _mm_add_ps(dot, _mm_mul_ps(_mm_loadu_ps(r_z + i_base), q_z));
+			_mm_store_ps(f_terms, _mm_min_ps(_mm_andnot_ps(sign, dot), one));
+
+			Real* terms = ref.m_terms.data();
+			for (int i_b = 0; i_b < n_b; i_b ++)
+				terms[m_rotJoints[i_base + i_b]] = f_terms[i_b];
+		}
+	}
+#else
+	for (int i_rot = 0; i_rot < n_rots; i_rot ++)
+	{
+		Real f_abc[3] = {
+			(Real)a[i_rot] * c_dequantize,
+			(Real)b[i_rot] * c_dequantize,
+			(Real)c[i_rot] * c_dequantize
+		};
+		Real sqr_sum = f_abc[0] * f_abc[0] + f_abc[1] * f_abc[1] + f_abc[2] * f_abc[2];
+		Real q[4];
+		int i_m = i_max[i_rot];
+		const int* slots = c_abc2wxyz[i_m];
+		q[i_m] = sqrt(std::max((Real)0, (Real)1 - sqr_sum));
+		q[slots[0]] = f_abc[0];
+		q[slots[1]] = f_abc[1];
+		q[slots[2]] = f_abc[2];
+		for (int i_ref = 0; i_ref < n_refs; i_ref ++)
+		{
+			Reference& ref = *refs[i_ref];
+			IKAssert(ref.m_nJoints == m_nJoints);
+			const Real* r_w = ref.m_rots.data();
+			const Real* r_x = r_w + m_nRotPad;
+			const Real* r_y = r_x + m_nRotPad;
+			const Real* r_z = r_y + m_nRotPad;
+			ref.m_terms[m_rotJoints[i_rot]] = std::min((Real)1
+												, fabs(r_w[i_rot] * q[0]
+													 + r_x[i_rot] * q[1]
+													 + r_y[i_rot] * q[2]
+													 + r_z[i_rot] * q[3]));
+		}
+	}
+#endif
+	const _TRANSFORM* fulls = m_fullData.data() + (std::size_t)i_theta * (std::size_t)n_fulls;
+	for (int i_ref = 0; i_ref < n_refs; i_ref ++)
+	{
+		Reference& ref = *refs[i_ref];
+		Real* terms = ref.m_terms.data();
+		for (int i_full = 0; i_full < n_fulls; i_full ++)
+		{
+			const _ROT& r = ref.m_fulls[i_full];
+			const _ROT& r_prime = fulls[i_full].r;
+			terms[m_fullJoints[i_full]] = std::min((Real)1
+											, fabs(r.w * r_prime.w
+												 + r.x * r_prime.x
+												 + r.y * r_prime.y
+												 + r.z * r_prime.z));
+		}
+
+		Real sigma_i_tm = (Real)0;
+		for (int i_tm = 0; i_tm < m_nJoints; i_tm ++)
+			sigma_i_tm += terms[i_tm];
+		errs[i_ref] = (Real)m_nJoints - sigma_i_tm;
+	}
+}
+
+#undef N_BATCH
@@ -0,0 +1,77 @@
+#pragma once
+#include <stdint.h>
+#include <vector>
+#include "Transform.hpp"
+
+// the compressed postures of a posture graph:
+//	a joint which has neither translation nor scale in any posture keeps only its rotation,
+//	quantized with the smallest-three scheme: the largest component of the quaternion is dropped,
+//	the other 3 are in [-1/sqrt(2), 1/sqrt(2)] and quantized into int16_t (8 bytes per joint vs 48 bytes of a _TRANSFORM).
+//	the other joints (i.e. the root) keep the full _TRANSFORM.
+//	a posture is stored as SoA: [a x n_pad][b x n_pad][c x n_pad][i_max x n_pad] for a batch decoding with SIMD.
+class CPGThetaCompressed
+{
+public:
+	// a reference posture laid out as the compressed postures for the batched error evaluation
+	class Reference
+	{
+	public:
+		Reference()
+			: m_nJoints(0)
+		{
+		}
+	private:
+		friend class CPGThetaCompressed;
+		int m_nJoints;
+		std::vector<Real> m_rots;		// [w x n_pad][x x n_pad][y x n_pad][z x n_pad] of the rotation-only joints
+		std::vector<_ROT> m_fulls;		// the rotations of the full transform joints
+		std::vector<Real> m_terms;		// the error term of each joint
+	};
+
+public:
+	CPGThetaCompressed();
+	void Initialize(const std::vector<TransformArchive>& thetas);
+	void Decode(int i_theta, TransformArchive& theta) const;
+
+	void SetReference(const TransformArchive& theta, Reference& ref) const;
+	// errs[i] is bit-identical to TransformArchive::Error_q(theta, Decode(i_thetas[i]))
+	void Error_q(Reference& ref, const uint32_t* i_thetas, int n_thetas, Real* errs) const;
+	// errs[i] for the posture i_theta against refs[i], the posture is decoded once for all the references
+	void Error_q(uint32_t i_theta, Reference* const* refs, int n_refs, Real* errs) const;
+
+	int N_Theta() const
+	{
+		return m_nThetas;
+	}
+
+	int N_Joints() const
+	{
+		return m_nJoints;
+	}
+
+	// the measured max rotation error of the quantization in radian
+	Real Error_max() const
+	{
+		return m_errMax;
+	}
+
+	std::size_t Bytes() const
+	{
+		return m_rotData.size() * sizeof(int16_t)
+			+ m_fullData.size() * sizeof(_TRANSFORM);
+	}
+
+private:
+	static void Encode(const _ROT& r, int16_t* a, int16_t* b, int16_t* c, int16_t* i_max);
+	void DecodeRotations(const int16_t* rots, TransformArchive& theta) const;
+
+private:
+	int m_nThetas;
+	int m_nJoints;
+	int m_nRotPad;						// number of rotation-only joints padded to a multiple of 8
+	std::vector<int> m_rotJoints;		// joint index of a rotation-only joint
+	std::vector<int> m_fullJoints;		// joint index of a full transform joint
+	std::vector<int16_t> m_rotData;
+	std::vector<_TRANSFORM> m_fullData;
+	Real m_errMax;
+};
@@ -0,0 +1,285 @@
+#include "pch.h"
+#include <math.h>
+#include <chrono>
+#include <algorithm>
+#include <limits>
+#include "PGThetaIndex.hpp"
+
+static const int c_jointsPerSub = 4;
+static const int c_maxCentroids = 256;
+static const int c_trainPerCentroid = 16;
+static const int c_iterations = 6;
+static const int c_rerank = 64;
+static const int c_scanCheck = 1024;		// the clock is read once per c_scanCheck vertices
+
+CPGThetaIndex::CPGThetaIndex(const CPGFileMapped& transitions, const CPGThetaCompressed& thetas)
+	: c_transitions(transitions)
+	, c_thetas(thetas)
+	, m_nJoints(thetas.N_Joints())
+	, m_nSubs(0)
+	, m_nCentroids(0)
+{
+	auto tick_start = std::chrono::steady_clock::now();
+	uint32_t n_vertices = transitions.N_Vertices();
+	if (0 == n_vertices || 0 == m_nJoints)
+		return;
+	m_nSubs = (m_nJoints + c_jointsPerSub - 1) / c_jointsPerSub;
+	m_nCentroids = (int)std::min<uint32_t>(c_maxCentroids, n_vertices);
+
+	TransformArchive theta_i;
+	int n_samples = (int)std::min<uint32_t>(n_vertices, (uint32_t)(m_nCentroids * c_trainPerCentroid));
+	std::vector<Real> samples((std::size_t)n_samples * m_nJoints * 4);
+	for (int i_sample = 0; i_sample < n_samples; i_sample ++)
+	{
+		uint32_t v = (uint32_t)(((uint64_t)i_sample * n_vertices) / (uint64_t)n_samples);
+		Decode(v, theta_i, &samples[(std::size_t)i_sample * m_nJoints * 4]);
+	}
+	Train(samples, n_samples);
+
+	std::vector<Real> theta(m_nJoints * 4);
+	m_codes.resize((std::size_t)n_vertices * m_nSubs);
+	for (uint32_t v = 0; v < n_vertices; v ++)
+	{
+		Decode(v, theta_i, theta.data());
+		for (int i_sub = 0; i_sub < m_nSubs; i_sub ++)
+			m_codes[(std::size_t)v * m_nSubs + i_sub] = (uint8_t)Encode(theta.data(), i_sub);
+	}
+
+	int ms_build = (int)std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - tick_start).count();
+	int kb_codes = (int)((m_codes.size() + m_centroids.size() * sizeof(Real)) >> 10);
+	LOGIKVar(LogInfoInt, m_nSubs);
+	LOGIKVar(LogInfoInt, m_nCentroids);
+	LOGIKVar(LogInfoInt, kb_codes);
+	LOGIKVar(LogInfoInt, ms_build);
+}
+
+void CPGThetaIndex::Decode(uint32_t v, TransformArchive& theta_i, Real* theta) const
+{
+	c_thetas.Decode((int)c_transitions.Theta(v), theta_i);
+	for (int i_joint = 0; i_joint < m_nJoints; i_joint ++)
+	{
+		const _ROT& r = theta_i[i_joint].r;
+		Real* q = theta + i_joint * 4;
+		q[0] = r.w; q[1] = r.x; q[2] = r.y; q[3] = r.z;
+	}
+}
+
+Real CPGThetaIndex::Error_q(const Real* theta, const Real* centroid, int n_joints)
+{
+	Real err = (Real)0;
+	for (int i_joint = 0; i_joint < n_joints; i_joint ++, theta += 4, centroid += 4)
+		err += (Real)1 - std::min((Real)1
+								, fabs(theta[0] * centroid[0]
+									 + theta[1] * centroid[1]
+									 + theta[2] * centroid[2]
+									 + theta[3] * centroid[3]));
+	return err;
+}
+
+int CPGThetaIndex::Encode(const Real* theta, int i_sub) const
+{
+	int i_joint_0 = i_sub * c_jointsPerSub;
+	int n_joints = std::min(c_jointsPerSub, m_nJoints - i_joint_0);
+	const Real* theta_sub = theta + i_joint_0 * 4;
+	const Real* centroids = &m_centroids[(std::size_t)i_sub * m_nCentroids * c_jointsPerSub * 4];
+	int i_min = 0;
+	Real err_min = std::numeric_limits<Real>::max();
+	for (int i_c = 0; i_c < m_nCentroids; i_c ++)
+	{
+		Real err = Error_q(theta_sub, centroids + i_c * c_jointsPerSub * 4, n_joints);
+		if (err < err_min)
+		{
+			err_min = err;
+			i_min = i_c;
+		}
+	}
+	return i_min;
+}
+
+// k-means per subspace with the error of Error_q, a centroid joint is the normalized sum of
+// the sample quaternions flipped to the hemisphere of the centroid
+void CPGThetaIndex::Train(const std::vector<Real>& samples, int n_samples)
+{
+	const int n_stride = c_jointsPerSub * 4;
+	m_centroids.assign((std::size_t)m_nSubs * m_nCentroids * n_stride, (Real)0);
+	std::vector<Real> sums((std::size_t)m_nCentroids * n_stride);
+	std::vector<int> counts(m_nCentroids);
+	for (int i_sub = 0; i_sub < m_nSubs; i_sub ++)
+	{
+		int i_joint_0 = i_sub * c_jointsPerSub;
+		int n_joints = std::min(c_jointsPerSub, m_nJoints - i_joint_0);
+		Real* centroids = &m_centroids[(std::size_t)i_sub * m_nCentroids * n_stride];
+		for (int i_c = 0; i_c < m_nCentroids; i_c ++)
+		{
+			int i_sample = (int)(((int64_t)i_c * n_samples) / m_nCentroids);
+			const Real* sample = &samples[((std::size_t)i_sample * m_nJoints + i_joint_0) * 4];
+			std::copy(sample, sample + n_joints * 4, centroids + i_c * n_stride);
+		}
+
+		for (int i_iter = 0; i_iter < c_iterations; i_iter ++)
+		{
+			std::fill(sums.begin(), sums.end(), (Real)0);
+			std::fill(counts.begin(), counts.end(), 0);
+			for (int i_sample = 0; i_sample < n_samples; i_sample ++)
+			{
+				const Real* sample = &samples[((std::size_t)i_sample * m_nJoints + i_joint_0) * 4];
+				int i_min = 0;
+				Real err_min = std::numeric_limits<Real>::max();
+				for (int i_c = 0; i_c < m_nCentroids; i_c ++)
+				{
+					Real err = Error_q(sample, centroids + i_c * n_stride, n_joints);
+					if (err < err_min)
+					{
+						err_min = err;
+						i_min = i_c;
+					}
+				}
+				counts[i_min] ++;
+				const Real* centroid = centroids + i_min * n_stride;
+				Real* sum = &sums[(std::size_t)i_min * n_stride];
+				for (int i_joint = 0; i_joint < n_joints; i_joint ++)
+				{
+					const Real* q = sample + i_joint * 4;
+					const Real* c = centroid + i_joint * 4;
+					Real sign = (q[0] * c[0] + q[1] * c[1] + q[2] * c[2] + q[3] * c[3] < 0) ? (Real)-1 : (Real)1;
+					for (int i_q = 0; i_q < 4; i_q ++)
+						sum[i_joint * 4 + i_q] += sign * q[i_q];
+				}
+			}
+
+			for (int i_c = 0; i_c < m_nCentroids; i_c ++)
+			{
+				if (0 == counts[i_c])
+					continue;				// an empty cluster keeps its centroid
+				for (int i_joint = 0; i_joint < n_joints; i_joint ++)
+				{
+					const Real* sum = &sums[(std::size_t)i_c * n_stride + i_joint * 4];
+					Real norm = sqrt(sum[0] * sum[0] + sum[1] * sum[1] + sum[2] * sum[2] + sum[3] * sum[3]);
+					if (norm > (Real)0)
+					{
+						Real* c = centroids + i_c * n_stride + i_joint * 4;
+						for (int i_q = 0; i_q < 4; i_q ++)
+							c[i_q] = sum[i_q] / norm;
+					}
+				}
+			}
+		}
+	}
+}
+
+uint32_t CPGThetaIndex::Nearest(const TransformArchive& theta
+								, CPGThetaCompressed::Reference& ref
+								, Query& query
+								, int budget_us
+								, Real* err) const
+{
+	int n_candidates = Rerank(theta, ref, query, budget_us);
+	if (0 == n_candidates)
+	{
+		*err = (Real)theta.Size();
+		return 0;
+	}
+	const auto& candidates = query.m_candidates;
+	int i_nn = 0;
+	for (int i_cand = 1; i_cand < n_candidates; i_cand ++)
+	{
+		if (candidates[i_cand].first < candidates[i_nn].first)
+			i_nn = i_cand;
+	}
+	*err = candidates[i_nn].first;
+	return candidates[i_nn].second;
+}
+
+int CPGThetaIndex::Nearest(const TransformArchive& theta
+						, CPGThetaCompressed::Reference& ref
+						, Query& query
+						, int budget_us
+						, int k
+						, uint32_t* vertices
+						, Real* errs) const
+{
+	int n_candidates = Rerank(theta, ref, query, budget_us);
+	int n_nearest = std::min(k, n_candidates);
+	auto& candidates = query.m_candidates;
+	std::partial_sort(candidates.begin(), candidates.begin() + n_nearest, candidates.end());
+	for (int i_nn = 0; i_nn < n_nearest; i_nn ++)
+	{
+		errs[i_nn] = candidates[i_nn].first;
+		vertices[i_nn] = candidates[i_nn].second;
+	}
+	return n_nearest;
+}
+
+int CPGThetaIndex::Rerank(const TransformArchive& theta
+						, CPGThetaCompressed::Reference& ref
+						, Query& query
+						, int budget_us) const
+{
+	uint32_t n_vertices = c_transitions.N_Vertices();
+	if ((int)theta.Size() != m_nJoints
+		|| m_codes.empty())
+		return 0;
+
+	auto tick_start = std::chrono::steady_clock::now();
+	query.n_queries ++;
+
+	const int n_stride = c_jointsPerSub * 4;
+	query.m_tables.resize((std::size_t)m_nSubs * m_nCentroids);
+	Real q_sub[c_jointsPerSub * 4];
+	for (int i_sub = 0; i_sub < m_nSubs; i_sub ++)
+	{
+		int i_joint_0 = i_sub * c_jointsPerSub;
+		int n_joints = std::min(c_jointsPerSub, m_nJoints - i_joint_0);
+		for (int i_joint = 0; i_joint < n_joints; i_joint ++)
+		{
+			const _ROT& r = theta[i_joint_0 + i_joint].r;
+			Real* q = q_sub + i_joint * 4;
+			q[0] = r.w; q[1] = r.x; q[2] = r.y; q[3] = r.z;
+		}
+		const Real* centroids = &m_centroids[(std::size_t)i_sub * m_nCentroids * n_stride];
+		Real* table = &query.m_tables[(std::size_t)i_sub * m_nCentroids];
+		for (int i_c = 0; i_c < m_nCentroids; i_c ++)
+			table[i_c] = Error_q(q_sub, centroids + i_c * n_stride, n_joints);
+	}
+
+	auto& candidates = query.m_candidates;
+	candidates.clear();
+	const Real* tables = query.m_tables.data();
+	uint32_t v = (query.m_scanFrom < n_vertices) ? query.m_scanFrom : 0;
+	bool cut = false;
+	for (uint32_t n_scanned = 0; n_scanned < n_vertices && !cut; n_scanned ++)
+	{
+		const uint8_t* code = &m_codes[(std::size_t)v * m_nSubs];
+		Real err_v = (Real)0;
+		for (int i_sub = 0; i_sub < m_nSubs; i_sub ++)
+			err_v += tables[i_sub * m_nCentroids + code[i_sub]];
+		if ((int)candidates.size() < c_rerank)
+		{
+			candidates.push_back(std::make_pair(err_v, v));
+			std::push_heap(candidates.begin(), candidates.end());
+		}
+		else if (err_v < candidates.front().first)
+		{
+			std::pop_heap(candidates.begin(), candidates.end());
+			candidates.back() = std::make_pair(err_v, v);
+			std::push_heap(candidates.begin(), candidates.end());
+		}
+		if (++ v == n_vertices)
+			v = 0;
+		cut = (0 == (n_scanned + 1) % c_scanCheck
+			&& std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - tick_start).count() > budget_us);
+	}
+	query.m_scanFrom = v;
+	if (cut)
+		query.n_cut ++;
+
+	int n_candidates = (int)candidates.size();
+	query.m_thetas.resize(n_candidates);
+	query.m_errs.resize(n_candidates);
+	for (int i_cand = 0; i_cand < n_candidates; i_cand ++)
+		query.m_thetas[i_cand] = c_transitions.Theta(candidates[i_cand].second);
+	c_thetas.Error_q(ref, query.m_thetas.data(), n_candidates, query.m_errs.data());
+	for (int i_cand = 0; i_cand < n_candidates; i_cand ++)
+		candidates[i_cand].first = query.m_errs[i_cand];
+	return n_candidates;
+}
@@ -0,0 +1,75 @@
+#pragma once
+#include <stdint.h>
+#include <vector>
+#include <utility>
+#include "Transform.hpp"
+#include "PGFileMapped.hpp"
+#include "PGThetaCompressed.hpp"
+
+// the global nearest posture index of a posture graph, a product-quantized flat index:
+//	the joints are split into subspaces of c_jointsPerSub joints, each subspace has a codebook of up to 256 postures,
+//	a vertex is encoded as 1 byte per subspace.
+//	the error TransformArchive::Error_q is a sum over the joints, so a query builds a table of the errors
+//	of the codebook entries per subspace, scans all the vertices by summing up the table entries,
+//	and reranks the best candidates with the exact error of the compressed postures.
+//	the scan is linear in the number of vertices and is cut when the time budget is used up.
+class CPGThetaIndex
+{
+public:
+	// the scratch of a query, a query is concurrent with others with its own scratch
+	class Query
+	{
+	public:
+		Query()
+			: n_queries(0)
+			, n_cut(0)
+			, m_scanFrom(0)
+		{
+		}
+		int n_queries;
+		int n_cut;						// number of queries of which the scan was cut by the budget
+	private:
+		friend class CPGThetaIndex;
+		std::vector<Real> m_tables;		// [subspace][centroid]
+		std::vector<std::pair<Real, uint32_t>> m_candidates;	// max-heap of (approximated error, vertex)
+		std::vector<uint32_t> m_thetas;
+		std::vector<Real> m_errs;
+		uint32_t m_scanFrom;			// a cut scan is continued by the next query
+	};
+
+public:
+	CPGThetaIndex(const CPGFileMapped& transitions, const CPGThetaCompressed& thetas);
+	// returns the vertex of the nearest posture to theta, ref is the reference of theta
+	uint32_t Nearest(const TransformArchive& theta
+					, CPGThetaCompressed::Reference& ref
+					, Query& query
+					, int budget_us
+					, Real* err) const;
+	// the k nearest of the reranked candidates in the ascending order of their errors, returns the number found:
+	// at most k and at most the number of the candidates reranked by a query
+	int Nearest(const TransformArchive& theta
+				, CPGThetaCompressed::Reference& ref
+				, Query& query
+				, int budget_us
+				, int k
+				, uint32_t* vertices
+				, Real* errs) const;
+private:
+	// query.m_candidates is rescored with the exact errors, returns the number of the candidates
+	int Rerank(const TransformArchive& theta
+				, CPGThetaCompressed::Reference& ref
+				, Query& query
+				, int budget_us) const;
+	void Train(const std::vector<Real>& samples, int n_samples);
+	int Encode(const Real* theta, int i_sub) const;
+	void Decode(uint32_t v, TransformArchive& theta_i, Real* theta) const;
+	static Real Error_q(const Real* theta, const Real* centroid, int n_joints);
+private:
+	const CPGFileMapped& c_transitions;
+	const CPGThetaCompressed& c_thetas;
+	int m_nJoints;
+	int m_nSubs;
+	int m_nCentroids;
+	std::vector<Real> m_centroids;		// [subspace][centroid][joint of the subspace][w, x, y, z]
+	std::vector<uint8_t> m_codes;		// [vertex][subspace]
+};
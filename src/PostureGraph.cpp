@@ -1,6 +1,8 @@
 #include "pch.h"
 #include "PostureGraph.hpp"
 #include "PostureGraph_helper.hpp"
+#include <mutex>
+#include <random>
 
 // [0, MAX_N_THETA_HOMO_PG)	[MAX_N_THETA_HOMO_PG, INFINIT)
 // [0, MAX_N_THETA_X_PG)	[MAX_N_THETA_X_PG, INFINIT)
@@ -19,13 +21,11 @@
 
 CPGThetaRuntime::CPGThetaRuntime(const char* path, CArtiBodyNode* body_ref)
 {
-	m_rootRef = body_ref;
 	Initialize(path, body_ref);
 }
 
 CPGThetaRuntime::CPGThetaRuntime(const std::string& path, CArtiBodyNode* body_ref)
 {
-	m_rootRef = body_ref;
 	Initialize(path, body_ref);
 }
 
@@ -36,10 +36,11 @@ void CPGThetaRuntime::Initialize(const std::string& path, CArtiBodyNode* root_re
 {
 	std::string exp("the standard body is not compatible with the bvh/htr file");
 	CArtiBodyFile abfile(path);
-	IKAssert(abfile.c_type == m_rootRef->c_type);
+	IKAssert(abfile.c_type == root_ref->c_type);
 	int n_frames = abfile.frames();
-	m_motions.resize(n_frames);
-	m_jointsRef.clear();
+	std::vector<TransformArchive> motions(n_frames);
+	m_jointNames.clear();
+	std::vector<IJoint*> jointsRef;
 
 	struct CHANNEL
 	{
@@ -99,7 +100,8 @@ void CPGThetaRuntime::Initialize(const std::string& path, CArtiBodyNode* root_re
 						&& NULL != channel.body_file);
 		if (valid_ch_i)
 		{
-			m_jointsRef.push_back(channel.body_ref->GetJoint());
+			jointsRef.push_back(channel.body_ref->GetJoint());
+			m_jointNames.push_back(channel.name);
 			IKAssert(std::string(channel.body_ref->GetName_c())
 					== std::string(channel.body_file->GetName_c()));
 		}
@@ -123,12 +125,12 @@ void CPGThetaRuntime::Initialize(const std::string& path, CArtiBodyNode* root_re
 
 	CArtiBodyFile::Bound root_file_bnd = std::make_pair(abfile.root_joint(), root_file);
 
-	int n_tms = (int)m_jointsRef.size();
+	int n_tms = (int)jointsRef.size();
 	TransformArchive tms_bk(n_tms);
 	for (int i_tm = 0; i_tm < n_tms; i_tm++)
 	{
 		_TRANSFORM& tm_i = tms_bk[i_tm];
-		m_jointsRef[i_tm]->GetTransform()->CopyTo(tm_i);
+		jointsRef[i_tm]->GetTransform()->CopyTo(tm_i);
 	}
 
 
@@ -148,12 +150,12 @@ void CPGThetaRuntime::Initialize(const std::string& path, CArtiBodyNode* root_re
 			joint_ref_i->SetTranslation(tm_file_i->getTranslation());
 		}
 
-		TransformArchive& motion_i = m_motions[i_frame];
+		TransformArchive& motion_i = motions[i_frame];
 		motion_i.Resize(n_tms);
 		for (int j_tm = 0; j_tm < n_tms; j_tm ++)
 		{
 			_TRANSFORM& tm_ij = motion_i[j_tm];
-			IJoint* joint_j = m_jointsRef[j_tm];
+			IJoint* joint_j = jointsRef[j_tm];
 			joint_j->GetTransform()->CopyTo(tm_ij);
 		}
 	}
@@ -161,8 +163,37 @@ void CPGThetaRuntime::Initialize(const std::string& path, CArtiBodyNode* root_re
 	for (int i_tm = 0; i_tm < n_tms; i_tm ++)
 	{
 		const _TRANSFORM& tm_i = tms_bk[i_tm];
-		m_jointsRef[i_tm]->GetTransform()->CopyFrom(tm_i);
+		jointsRef[i_tm]->GetTransform()->CopyFrom(tm_i);
+	}
+
+	m_motions.Initialize(motions);
+}
+
+bool CPGThetaRuntime::Bind(CArtiBodyNode* root, std::vector<IJoint*>& joints) const
+{
+	std::map<std::string, IJoint*> name2joint;
+	auto onEnterBody = [&name2joint](CArtiBodyNode* body)
+		{
+			name2joint[body->GetName_c()] = body->GetJoint();
+		};
+	auto onLeaveBody = [](CArtiBodyNode* body)
+		{
+		};
+	CArtiBodyTree::TraverseDFS(root, onEnterBody, onLeaveBody);
+
+	std::size_t n_joints = m_jointNames.size();
+	joints.resize(n_joints);
+	bool bound = true;
+	for (std::size_t i_joint = 0; i_joint < n_joints && bound; i_joint ++)
+	{
+		auto it_joint = name2joint.find(m_jointNames[i_joint]);
+		bound = (name2joint.end() != it_joint);
+		if (bound)
+			joints[i_joint] = it_joint->second;
 	}
+	if (!bound)
+		joints.clear();
+	return bound;
 }
 
 CPGTheta::CPGTheta(const char* path)
@@ -439,14 +470,221 @@ void CPG::Initialize(CPG& graph, const Registry& reg, const CPGTheta& theta_src)
 
 }
 
-void CPG::Save(const char* dir) const
+void CPG::BoundDegree(std::size_t deg_max)
+{
+	struct E_ERR
+	{
+		vertex_descriptor v_0;
+		vertex_descriptor v_1;
+		Real err;
+	};
+
+	CPG& graph = *this;
+	std::size_t n_vertices = boost::num_vertices(graph);
+	std::size_t n_edges_0 = boost::num_edges(graph);
+	std::size_t deg_max_0 = 0;
+	auto v_range = boost::vertices(graph);
+	for (auto it_v = v_range.first; it_v != v_range.second; it_v ++)
+		deg_max_0 = std::max(deg_max_0, boost::degree(*it_v, graph));
+
+	std::vector<E_ERR> edges;
+	edges.reserve(n_edges_0);
+	auto e_range = boost::edges(graph);
+	for (auto it_e = e_range.first; it_e != e_range.second; it_e ++)
+	{
+		vertex_descriptor v[] = { boost::source(*it_e, graph), boost::target(*it_e, graph) };
+		if (v[0] != v[1])
+			edges.push_back({std::min(v[0], v[1]), std::max(v[0], v[1]), m_theta.Error_q((int)v[0], (int)v[1])});
+	}
+	std::sort(edges.begin(), edges.end()
+			, [](const E_ERR& e_i, const E_ERR& e_j)
+				{
+					return (e_i.err < e_j.err)
+						|| (e_i.err == e_j.err && (e_i.v_0 < e_j.v_0
+												|| (e_i.v_0 == e_j.v_0 && e_i.v_1 < e_j.v_1)));
+				});
+	edges.erase(std::unique(edges.begin(), edges.end()
+						, [](const E_ERR& e_i, const E_ERR& e_j)
+							{
+								return e_i.v_0 == e_j.v_0 && e_i.v_1 == e_j.v_1;
+							})
+				, edges.end());
+
+	// the backbone: Kruskal over the edges by error, joining first by the edges under deg_max at both ends,
+	// then by any edge for the trees the first pass leaves apart
+	std::vector<vertex_descriptor> parent(n_vertices);
+	for (std::size_t v = 0; v < n_vertices; v ++)
+		parent[v] = v;
+	auto Root = [&parent](vertex_descriptor v) -> vertex_descriptor
+		{
+			while (parent[v] != v)
+			{
+				parent[v] = parent[parent[v]];
+				v = parent[v];
+			}
+			return v;
+		};
+
+	std::vector<std::size_t> deg(n_vertices, 0);
+	std::vector<bool> kept(edges.size(), false);
+	std::size_t n_edges = edges.size();
+	for (int i_pass = 0; i_pass < 2; i_pass ++)
+	{
+		bool bounded = (0 == i_pass);
+		for (std::size_t i_e = 0; i_e < n_edges; i_e ++)
+		{
+			const E_ERR& e = edges[i_e];
+			if (kept[i_e]
+				|| (bounded && (deg[e.v_0] >= deg_max || deg[e.v_1] >= deg_max)))
+				continue;
+			vertex_descriptor r[] = { Root(e.v_0), Root(e.v_1) };
+			if (r[0] != r[1])
+			{
+				parent[r[0]] = r[1];
+				kept[i_e] = true;
+				deg[e.v_0] ++; deg[e.v_1] ++;
+			}
+		}
+	}
+
+	// the closest neighbors while both ends are under deg_max
+	for (std::size_t i_e = 0; i_e < n_edges; i_e ++)
+	{
+		const E_ERR& e = edges[i_e];
+		if (!kept[i_e]
+			&& deg[e.v_0] < deg_max
+			&& deg[e.v_1] < deg_max)
+		{
+			kept[i_e] = true;
+			deg[e.v_0] ++; deg[e.v_1] ++;
+		}
+	}
+
+	for (auto it_v = v_range.first; it_v != v_range.second; it_v ++)
+		boost::clear_vertex(*it_v, graph);
+	for (std::size_t i_e = 0; i_e < n_edges; i_e ++)
+	{
+		if (kept[i_e])
+			boost::add_edge(edges[i_e].v_0, edges[i_e].v_1, graph);
+	}
+
+	std::size_t n_edges_bound = boost::num_edges(graph);
+	std::size_t deg_max_bound = 0;
+	for (auto deg_v : deg)
+		deg_max_bound = std::max(deg_max_bound, deg_v);
+	LOGIKVar(LogInfoInt, n_edges_0);
+	LOGIKVar(LogInfoInt, deg_max_0);
+	LOGIKVar(LogInfoInt, n_edges_bound);
+	LOGIKVar(LogInfoInt, deg_max_bound);
+}
+
+void CPG::AddShortcuts(int n_links)
+{
+	struct V_ERR
+	{
+		vertex_descriptor v;
+		Real err;
+		bool operator<(const V_ERR& other) const
+		{
+			return err < other.err;
+		}
+		bool operator>(const V_ERR& other) const
+		{
+			return err > other.err;
+		}
+	};
+
+	CPG& graph = *this;
+	std::size_t n_vertices = boost::num_vertices(graph);
+	std::size_t n_edges_0 = boost::num_edges(graph);
+	if (n_vertices < 2 || n_links < 1)
+		return;
+
+	const int ef = std::max(16, n_links << 2);		// the candidates kept by a search
+	const std::size_t deg_max = (std::size_t)n_links << 1;
+
+	std::vector<vertex_descriptor> order(n_vertices);
+	for (std::size_t v = 0; v < n_vertices; v ++)
+		order[v] = v;
+	std::mt19937 rng(n_vertices);	// the same graph gets the same shortcuts
+	std::shuffle(order.begin(), order.end(), rng);
+
+	std::vector<std::vector<vertex_descriptor>> layer(n_vertices);
+	std::vector<uint32_t> visited(n_vertices, 0);
+	uint32_t epoch = 0;
+	std::priority_queue<V_ERR, std::vector<V_ERR>, std::greater<V_ERR>> candidates;
+	std::priority_queue<V_ERR> nearest;
+	std::vector<V_ERR> links;
+	std::size_t n_shortcuts = 0;
+	for (std::size_t i_order = 1; i_order < n_vertices; i_order ++)
+	{
+		vertex_descriptor v = order[i_order];
+		vertex_descriptor v_entry = order[0];
+		epoch ++;
+		V_ERR entry = {v_entry, m_theta.Error_q((int)v, (int)v_entry)};
+		visited[v_entry] = epoch;
+		candidates.push(entry);
+		nearest.push(entry);
+		while (!candidates.empty())
+		{
+			V_ERR c = candidates.top();
+			if (c.err > nearest.top().err)
+				break;
+			candidates.pop();
+			for (vertex_descriptor v_n : layer[c.v])
+			{
+				if (epoch == visited[v_n])
+					continue;
+				visited[v_n] = epoch;
+				V_ERR n = {v_n, m_theta.Error_q((int)v, (int)v_n)};
+				if ((int)nearest.size() < ef
+					|| n.err < nearest.top().err)
+				{
+					candidates.push(n);
+					nearest.push(n);
+					if ((int)nearest.size() > ef)
+						nearest.pop();
+				}
+			}
+		}
+		while (!candidates.empty())
+			candidates.pop();
+
+		links.clear();
+		for (; !nearest.empty(); nearest.pop())
+			links.push_back(nearest.top());
+		int n_linked = 0;
+		for (auto it_link = links.rbegin()
+			; it_link != links.rend() && n_linked < n_links
+			; it_link ++)
+		{
+			vertex_descriptor v_n = it_link->v;
+			if (layer[v_n].size() < deg_max)
+			{
+				layer[v].push_back(v_n);
+				layer[v_n].push_back(v);
+				n_linked ++;
+				if (!boost::edge(v, v_n, graph).second)
+				{
+					boost::add_edge(v, v_n, graph);
+					n_shortcuts ++;
+				}
+			}
+		}
+	}
+
+	LOGIKVar(LogInfoInt, n_edges_0);
+	LOGIKVar(LogInfoInt, n_shortcuts);
+}
+
+bool CPG::Save(const char* dir) const
 {
 	std::string file_name(m_theta.GetBody()->GetName_c());
 
 	fs::path path_t(dir);
 	std::string file_name_t(file_name); file_name_t += ".pg";
 	path_t.append(file_name_t);
-	SaveTransitions(path_t.u8string().c_str(), F_PG);
+	bool saved = SaveTransitions(path_t.u8string().c_str(), F_PG, &m_theta);
 
 	fs::path htr_path(dir);
 	std::string htr_file_name(file_name); htr_file_name += ".htr";
@@ -460,6 +698,7 @@ void CPG::Save(const char* dir) const
 	}
 	m_theta.ResetPose<false>();
 	abfile.WriteBvhFile(htr_path.u8string().c_str());
+	return saved;
 }
 
 bool CPG::Load(const char* dir, const char* pg_name)
@@ -614,7 +853,110 @@ void CPGListGen::Remove(vertex_descriptor v, const IErrorTB* errTB)
 	}
 }
 
-bool CPGRuntime::Load(const char* dir, CArtiBodyNode* root)
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// CPGRuntimeShared: the registry of the graphs loaded by the process
+
+static std::mutex s_registryLock;
+static std::map<std::string, CPGRuntimeShared*> s_registry;
+
+const CPGRuntimeShared* CPGRuntimeShared::Acquire(const char* dir, CArtiBodyNode* rootBody)
+{
+	std::string key = Key(dir, rootBody);
+	CPGRuntimeShared* pg = NULL;
+	{
+		std::lock_guard<std::mutex> lock(s_registryLock);
+		auto it_pg = s_registry.find(key);
+		if (s_registry.end() != it_pg)
+		{
+			pg = it_pg->second;
+			pg->m_refCount ++;
+		}
+	}
+
+	if (NULL == pg)
+	{
+		// the graph is loaded out of the lock so that different graphs are loaded concurrently
+		CPGRuntimeShared* pg_loaded = new CPGRuntimeShared();
+		if (!pg_loaded->Load(dir, rootBody))
+		{
+			delete pg_loaded;
+			return NULL;
+		}
+		pg_loaded->m_key = key;
+
+		std::lock_guard<std::mutex> lock(s_registryLock);
+		auto it_pg = s_registry.find(key);
+		if (s_registry.end() != it_pg)		// the same graph is loaded by another thread meanwhile
+		{
+			pg = it_pg->second;
+			delete pg_loaded;
+		}
+		else
+		{
+			pg = pg_loaded;
+			s_registry[key] = pg;
+		}
+		pg->m_refCount ++;
+	}
+	LOGIKVar(LogInfoCharPtr, key.c_str());
+	return pg;
+}
+
+void CPGRuntimeShared::Release(const CPGRuntimeShared* pg_c)
+{
+	CPGRuntimeShared* pg = const_cast<CPGRuntimeShared*>(pg_c);
+	std::lock_guard<std::mutex> lock(s_registryLock);
+	IKAssert(0 < pg->m_refCount);
+	if (0 == -- pg->m_refCount)
+	{
+		s_registry.erase(pg->m_key);
+		delete pg;
+	}
+}
+
+// the postures of a graph are bound to a body by the joint names of the body
+std::string CPGRuntimeShared::Key(const char* dir, const CArtiBodyNode* rootBody)
+{
+	std::stringstream key;
+	key << fs::absolute(fs::path(dir)).u8string() << "|" << (int)rootBody->c_type;
+	auto onEnterBody = [&key](const CArtiBodyNode* body) -> bool
+		{
+			key << "|" << body->GetName_c();
+			return true;
+		};
+	auto onLeaveBody = [](const CArtiBodyNode* body) -> bool
+		{
+			return true;
+		};
+	CArtiBodyTree::TraverseDFS(rootBody, onEnterBody, onLeaveBody);
+	return key.str();
+}
+
+CPGRuntimeShared::CPGRuntimeShared()
+	: m_thetas(NULL)
+	, m_index(NULL)
+	, m_refCount(0)
+{
+}
+
+CPGRuntimeShared::~CPGRuntimeShared()
+{
+	if (NULL != m_index)
+		delete m_index;
+	if (NULL != m_thetas)
+		delete m_thetas;
+}
+
+const CPGThetaIndex* CPGRuntimeShared::Index() const
+{
+	std::call_once(m_indexBuilt, [this]()
+		{
+			m_index = new CPGThetaIndex(m_transitions, m_thetas->Motions());
+		});
+	return m_index;
+}
+
+bool CPGRuntimeShared::Load(const char* dir, CArtiBodyNode* root)
 {
 	const char* pg_name = root->GetName_c();
 	fs::path dir_path(dir);
@@ -629,28 +971,39 @@ bool CPGRuntime::Load(const char* dir, CArtiBodyNode* root)
 	LOGIKVar(LogInfoCharPtr, pg_name);
 	LOGIKVar(LogInfoBool, loaded_transi);
 	LOGIKVar(LogInfoBool, loaded_theta);
+	LOGIKVar(LogInfoBool, m_transitions.Mapped());
 	bool loaded =  (loaded_transi && loaded_theta);
+	if (loaded
+		&& !m_transitions.ValidThetas((uint32_t)m_thetas->N_Theta()))
+	{
+		LOGIKVarErr(LogInfoCharPtr, path_transi.u8string().c_str());
+		loaded = false;
+	}
 
-#if defined _DEBUG
-	IKAssert(!loaded || m_thetas->N_Theta() == num_vertices(*this));
-	if (loaded)
+	return loaded;
+}
+
+bool CPGRuntimeShared::LoadTransitions(const char* filePath)
+{
+	bool loaded = false;
+	if (CPGFileMapped::Recognize(filePath))
+		loaded = m_transitions.Map(filePath);
+	else
 	{
-		bool all_vertices_error_untagged = true;
-		//check error
-		auto v_range = boost::vertices(*this);
-		for (vertex_iterator it_v = v_range.first; it_v != v_range.second && all_vertices_error_untagged; it_v++)
+		// the legacy .pg file is converted into a CSR owned by this process
+		CPGTransition legacy(0);
+		loaded = legacy.LoadTransitions(filePath);
+		if (loaded)
 		{
-			const auto& v_property = (*this)[*it_v];
-			all_vertices_error_untagged = !ErrorTagged(v_property);
+			std::vector<uint32_t> row, adj, v2theta;
+			legacy.ToCSR(row, adj, v2theta);
+			m_transitions.Assign(row, adj, v2theta);
 		}
-		IKAssert(all_vertices_error_untagged);
 	}
-#endif
-
 	return loaded;
 }
 
-bool CPGRuntime::LoadThetas(const char* filePath, CArtiBodyNode* body_ref)
+bool CPGRuntimeShared::LoadThetas(const char* filePath, CArtiBodyNode* body_ref)
 {
 	if (NULL != m_thetas)
 		delete m_thetas;
@@ -658,7 +1011,6 @@ bool CPGRuntime::LoadThetas(const char* filePath, CArtiBodyNode* body_ref)
 	try
 	{
 		m_thetas = new CPGThetaRuntime(filePath, body_ref);
-		m_theta_star = 0;
 		loaded = true;
 	}
 	catch(std::string& exp)
@@ -671,6 +1023,69 @@ bool CPGRuntime::LoadThetas(const char* filePath, CArtiBodyNode* body_ref)
 	return loaded;
 }
 
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// CPGRuntime
+
+bool CPGRuntime::Load(const char* dir, CArtiBodyNode* root)
+{
+	if (NULL != m_shared)
+		CPGRuntimeShared::Release(m_shared);
+	m_shared = CPGRuntimeShared::Acquire(dir, root);
+	bool loaded = (NULL != m_shared
+				&& m_shared->Thetas().Bind(root, m_jointsRef));
+	if (loaded)
+	{
+		m_rootRef = root;
+		m_search.Initialize(m_shared->Transitions().N_Vertices());
+		m_overlay.Initialize(&m_shared->Transitions(), m_nEefs);
+		m_theta_star = 0;
+	}
+	else if (NULL != m_shared)
+	{
+		CPGRuntimeShared::Release(m_shared);
+		m_shared = NULL;
+	}
+	return loaded;
+}
+
+void CPGRuntime::ComputeEefs(const CPGRuntimeShared* pg
+							, CArtiBodyNode* root
+							, const std::vector<CArtiBodyNode*>& eefs
+							, std::vector<_TRANSFORM>& eefs_theta)
+{
+	const CPGThetaRuntime& thetas = pg->Thetas();
+	std::vector<IJoint*> joints;
+	eefs_theta.clear();
+	if (!thetas.Bind(root, joints))
+		return;
+	int n_thetas = thetas.N_Theta();
+	std::size_t n_eefs = eefs.size();
+	eefs_theta.resize((std::size_t)n_thetas * n_eefs);
+	TransformArchive theta_i;
+	for (int i_theta = 0; i_theta < n_thetas; i_theta ++)
+	{
+		thetas.PoseBody<true>(i_theta, joints, root, theta_i);
+		SerializeEefs(eefs, &eefs_theta[(std::size_t)i_theta * n_eefs]);
+	}
+	int kb_eefs = (int)((eefs_theta.size() * sizeof(_TRANSFORM)) >> 10);
+	LOGIKVar(LogInfoInt, kb_eefs);
+}
+
+void CPGRuntime::SerializeEefs(const std::vector<CArtiBodyNode*>& eefs, _TRANSFORM* eefs_theta)
+{
+	std::size_t n_eefs = eefs.size();
+	for (std::size_t i_eef = 0; i_eef < n_eefs; i_eef ++)
+	{
+		const Transform* tm_eef = eefs[i_eef]->GetTransformLocal2World();
+		Eigen::Vector3r tt = tm_eef->getTranslation();
+		Eigen::Quaternionr r = Transform::getRotation_q(tm_eef);
+		_TRANSFORM& eef_i = eefs_theta[i_eef];
+		eef_i.s.x = (Real)1; eef_i.s.y = (Real)1; eef_i.s.z = (Real)1;
+		eef_i.r.w = r.w(); eef_i.r.x = r.x(); eef_i.r.y = r.y(); eef_i.r.z = r.z();
+		eef_i.tt.x = tt.x(); eef_i.tt.y = tt.y(); eef_i.tt.z = tt.z();
+	}
+}
+
 #undef MED_N_THETA_HOMO_ETB
 #undef MED_N_THETA_X_ETB
 
@@ -18,52 +18,93 @@
 #include <string>
 #include <vector>
 #include <queue>
+#include <mutex>
+#include <chrono>
 #include "ArtiBodyFile.hpp"
 #include "filesystem_helper.hpp"
 #include "Math.hpp"
 #include "ArtiBody.hpp"
 #include "IKChain.hpp"
 #include "ErrorTB.hpp"
+#include "PGFileMapped.hpp"
+#include "PGThetaCompressed.hpp"
+#include "PGThetaIndex.hpp"
+#include "PGEefIndex.hpp"
+#include "PGOverlay.hpp"
 
 enum PG_FileType {F_PG = 0, F_DOT};
 
-// it should be optimized to get rid of derivation to avoid unnecessary memory consumption from BvhObject from runtime.
+// the postures are shared by the bodies of the same joint names,
+// a body is bound to the postures by the joint names.
+// the postures are kept compressed, a posture is decoded into a caller's archive
 class CPGThetaRuntime
 {
 public:
 	CPGThetaRuntime(const char* path, CArtiBodyNode* body_ref);
 	CPGThetaRuntime(const std::string& path, CArtiBodyNode* body_ref);
+
+	bool Bind(CArtiBodyNode* root, std::vector<IJoint*>& joints) const;
+
 	template<bool G_SPACE>
-	void PoseBody(int i_frame) const
+	void PoseBody(int i_frame, const std::vector<IJoint*>& joints, CArtiBodyNode* root, TransformArchive& motion_i) const
 	{
-		const TransformArchive& motion_i = m_motions[i_frame];
-		std::size_t n_tms = m_jointsRef.size();
+		m_motions.Decode(i_frame, motion_i);
+		PoseBody<G_SPACE>(motion_i, joints, root);
+	}
+
+	// the body is posed with a posture not in the file, e.g. of a posture graph overlay
+	template<bool G_SPACE>
+	static void PoseBody(const TransformArchive& motion_i, const std::vector<IJoint*>& joints, CArtiBodyNode* root)
+	{
+		std::size_t n_tms = joints.size();
 		for (std::size_t j_tm = 0; j_tm < n_tms; j_tm ++)
 		{
-			const _TRANSFORM& tm_ij = motion_i[j_tm];
-			IJoint* joint_j = m_jointsRef[j_tm];
+			const _TRANSFORM& tm_ij = motion_i[(int)j_tm];
+			IJoint* joint_j = joints[j_tm];
 			joint_j->GetTransform()->CopyFrom(tm_ij);
 		}
-		CArtiBodyTree::FK_Update<G_SPACE>(m_rootRef);
+		CArtiBodyTree::FK_Update<G_SPACE>(root);
 	}
 	int N_Theta() const
 	{
-		return (int)m_motions.size();
+		return m_motions.N_Theta();
+	}
+
+	void GetTM(int pose_id, TransformArchive& tm) const
+	{
+		m_motions.Decode(pose_id, tm);
+	}
+
+	const CPGThetaCompressed& Motions() const
+	{
+		return m_motions;
+	}
+
+	void GetErrRef(const TransformArchive& tm, CPGThetaCompressed::Reference& ref) const
+	{
+		m_motions.SetReference(tm, ref);
 	}
 
-	const TransformArchive& GetTM(int pose_id) const
+	// the batched TransformArchive::Error_q(tm, GetTM(pose_ids[i])) with the reference tm
+	void Error_q(CPGThetaCompressed::Reference& ref, const uint32_t* pose_ids, int n_poses, Real* errs) const
 	{
-		return m_motions[pose_id];
+		m_motions.Error_q(ref, pose_ids, n_poses, errs);
 	}
 
-	void GetRefBodyTM(TransformArchive& atm) const
+	// TransformArchive::Error_q(GetTM(pose_id), tm_i) for the references tm_i of several searches
+	void Error_q(uint32_t pose_id, CPGThetaCompressed::Reference* const* refs, int n_refs, Real* errs) const
 	{
-		std::size_t n_tms = m_jointsRef.size();
-		atm.Resize(n_tms);
+		m_motions.Error_q(pose_id, refs, n_refs, errs);
+	}
+
+	static void GetBodyTM(const std::vector<IJoint*>& joints, TransformArchive& atm)
+	{
+		std::size_t n_tms = joints.size();
+		atm.Resize((int)n_tms);
 		for (std::size_t j_tm = 0; j_tm < n_tms; j_tm ++)
 		{
-			_TRANSFORM& tm_ij = atm[j_tm];
-			IJoint* joint_j = m_jointsRef[j_tm];
+			_TRANSFORM& tm_ij = atm[(int)j_tm];
+			IJoint* joint_j = joints[j_tm];
 			joint_j->GetTransform()->CopyTo(tm_ij);
 		}
 	}
@@ -72,9 +113,8 @@ private:
 	void Initialize(const std::string& path, CArtiBodyNode* body_std);
 
 private:
-	std::vector<IJoint*> m_jointsRef;
-	CArtiBodyNode* m_rootRef;
-	std::vector<TransformArchive> m_motions;
+	std::vector<std::string> m_jointNames;
+	CPGThetaCompressed m_motions;
 };
 
 class CPGTheta
@@ -123,6 +163,12 @@ public:
 
 	int N_Theta() const {return (int)m_motions.size();}
 
+	// the posture error over all the joints, the error the runtime measures between 2 postures
+	Real Error_q(int i_theta, int j_theta) const
+	{
+		return TransformArchive::Error_q(m_motions[i_theta], m_motions[j_theta]);
+	}
+
 	const CArtiBodyNode* GetBody() const { return m_rootBody; }
 	CArtiBodyNode* GetBody() { return m_rootBody;  }
 
@@ -227,16 +273,6 @@ inline bool ErrorTagged(const VertexSearch& v_prop)
 	return (v_prop.err > CIKChain::ERROR_MIN);
 }
 
-inline bool ErrorTagged(Real err)
-{
-	return (err > CIKChain::ERROR_MIN);
-}
-
-inline void EraseTag(VertexSearch& v_prop)
-{
-	v_prop.err = CIKChain::ERROR_MIN;
-}
-
 class CPGTransition : public PostureGraphList<VertexSearch, boost::no_property>
 {
 public:
@@ -245,34 +281,107 @@ public:
 	{
 	}
 
-	void SaveTransitions(const char* filePath, PG_FileType type) const
+	// the edges are weighted with the posture errors for a given theta
+	bool SaveTransitions(const char* filePath, PG_FileType type, const CPGTheta* theta = NULL) const
 	{
-		std::ofstream file(filePath, std::ofstream::binary);
-		IKAssert(std::ios_base::failbit != file.rdstate());
-		if (std::ios_base::failbit == file.rdstate())
-		{
-			LOGIKVarErr(LogInfoCharPtr, filePath);
-			return;
-		}
 		if (F_DOT == type)
+		{
+			std::ofstream file(filePath, std::ofstream::binary);
+			IKAssert(std::ios_base::failbit != file.rdstate());
+			if (std::ios_base::failbit == file.rdstate())
+			{
+				LOGIKVarErr(LogInfoCharPtr, filePath);
+				return false;
+			}
 			write_graphviz(file, *this);
+			return file.good();
+		}
 		else
 		{
-			boost::archive::binary_oarchive oa(file);
-			boost::serialization::save(oa, *this, (unsigned int)0);
+			std::vector<uint32_t> row, adj, v2theta;
+			ToCSR(row, adj, v2theta);
+			std::vector<float> weights;
+			if (NULL != theta)
+			{
+				weights.resize(adj.size());
+				std::size_t n_vertices = v2theta.size();
+				for (std::size_t v = 0; v < n_vertices; v ++)
+				{
+					for (uint32_t i_adj = row[v]; i_adj < row[v + 1]; i_adj ++)
+						weights[i_adj] = (float)theta->Error_q((int)v2theta[v], (int)v2theta[adj[i_adj]]);
+				}
+			}
+			bool saved = CPGFileMapped::Save(filePath, row, adj, v2theta, weights);
+			if (!saved)
+				LOGIKVarErr(LogInfoCharPtr, filePath);
+			return saved;
 		}
 	}
 
 	bool LoadTransitions(const char* filePath)
 	{
-		std::ifstream file(filePath, std::ifstream::binary);
-		bool loaded = (std::ios_base::failbit != file.rdstate());
-		if (loaded)
+		if (CPGFileMapped::Recognize(filePath))
+		{
+			CPGFileMapped file;
+			bool loaded = file.Map(filePath);
+			if (loaded)
+				FromCSR(file);
+			return loaded;
+		}
+		else	// the legacy .pg file: a boost binary archive
+		{
+			std::ifstream file(filePath, std::ifstream::binary);
+			bool loaded = (std::ios_base::failbit != file.rdstate());
+			if (loaded)
+			{
+				boost::archive::binary_iarchive ia(file);
+				boost::serialization::load(ia, *this, (unsigned int)0);
+			}
+			return loaded;
+		}
+	}
+
+	// vertex i is posture i for a generated graph
+	void ToCSR(std::vector<uint32_t>& row, std::vector<uint32_t>& adj, std::vector<uint32_t>& v2theta) const
+	{
+		std::size_t n_vertices = boost::num_vertices(*this);
+		row.resize(n_vertices + 1);
+		v2theta.resize(n_vertices);
+		adj.clear();
+		adj.reserve(boost::num_edges(*this) << 1);
+		for (std::size_t v = 0; v < n_vertices; v ++)
+		{
+			row[v] = (uint32_t)adj.size();
+			v2theta[v] = (uint32_t)v;
+			auto vertices_range_neighbors = boost::adjacent_vertices(v, *this);
+			for (auto it_v_n = vertices_range_neighbors.first
+				; it_v_n != vertices_range_neighbors.second
+				; it_v_n ++)
+				adj.push_back((uint32_t)*it_v_n);
+		}
+		row[n_vertices] = (uint32_t)adj.size();
+	}
+
+	void FromCSR(const CPGFileMapped& csr)
+	{
+		clear();
+		uint32_t n_vertices = csr.N_Vertices();
+		for (uint32_t v = 0; v < n_vertices; v ++)
 		{
-			boost::archive::binary_iarchive ia(file);
-			boost::serialization::load(ia, *this, (unsigned int)0);
+			IKAssert(v == csr.Theta(v));
+			vertex_descriptor v_added = boost::add_vertex(*this);
+			(*this)[v_added].err = CIKChain::ERROR_MIN;
+		}
+		for (uint32_t v = 0; v < n_vertices; v ++)
+		{
+			for (const uint32_t* it_v_n = csr.AdjacentBegin(v)
+				; it_v_n != csr.AdjacentEnd(v)
+				; it_v_n ++)
+			{
+				if (v < *it_v_n) // each undirected edge appears twice in the CSR
+					boost::add_edge(v, *it_v_n, *this);
+			}
 		}
-		return loaded;
 	}
 };
 
@@ -327,8 +436,18 @@ public:
 	virtual ~CPG();
 
 	static void Initialize(CPG& graph_src, const Registry& reg, const CPGTheta& theta_src);	
+	// caps the degree of the vertices to deg_max by keeping the edges to the closest postures,
+	// a spanning forest by posture error is kept as a backbone so no component is split,
+	// a vertex exceeds deg_max only if its backbone edges do
+	void BoundDegree(std::size_t deg_max);
+	// adds a layer of long-range shortcut edges as a navigable small-world graph does:
+	//	the vertices are inserted in a random order, each linked to its n_links nearest postures
+	//	found by a best-first search over the layer inserted before it,
+	//	so the vertices inserted early keep the long edges and a search crosses the graph in a few hops.
+	//	a vertex takes at most 2 * n_links shortcuts
+	void AddShortcuts(int n_links);
 	bool Load(const char* dir, const char* pg_name);
-	void Save(const char* dir) const;
+	bool Save(const char* dir) const;
 	const CPGTheta& Theta() const
 	{
 		return m_theta;
@@ -339,20 +458,257 @@ private:
 	CPGTheta m_theta;
 };
 
-class CPGRuntime : public CPGTransition
+// the graph and the postures loaded by a process are shared by the pipelines of the same body:
+//	they are registered by the graph directory and the body signature, and released by reference count
+class CPGRuntimeShared
+{
+public:
+	static const CPGRuntimeShared* Acquire(const char* dir, CArtiBodyNode* rootBody);
+	static void Release(const CPGRuntimeShared* pg);
+
+	const CPGFileMapped& Transitions() const
+	{
+		return m_transitions;
+	}
+
+	const CPGThetaRuntime& Thetas() const
+	{
+		return *m_thetas;
+	}
+
+	// the nearest posture index is built by the first caller
+	const CPGThetaIndex* Index() const;
+
+private:
+	CPGRuntimeShared();
+	~CPGRuntimeShared();
+	bool Load(const char* dir, CArtiBodyNode* rootBody);
+	bool LoadTransitions(const char* filePath);
+	bool LoadThetas(const char* filePath, CArtiBodyNode* body_ref);
+	static std::string Key(const char* dir, const CArtiBodyNode* rootBody);
+
+private:
+	CPGFileMapped m_transitions;
+	CPGThetaRuntime* m_thetas;
+	mutable std::once_flag m_indexBuilt;
+	mutable CPGThetaIndex* m_index;
+	std::string m_key;
+	int m_refCount;
+};
+
+// the search state of LocalMin:
+//	a vertex is visited by the current search if its stamp equals the epoch,
+//	a visited vertex is bounded if its error is only a lower bound (LocalMin_bound),
+//	a search starts a new epoch instead of erasing the state of the previous search,
+//	the heap is preallocated for all the vertices, a search allocates nothing.
+//	searches over the same graph are concurrent with different contexts
+class CPGSearchContext
+{
+public:
+	typedef uint32_t vertex_descriptor;
+
+	class GreatorThetaErr
+	{
+	public:
+		explicit GreatorThetaErr(const std::vector<Real>& a_errs)
+			: m_errs_ref(a_errs)
+		{
+		}
+		bool operator()(const vertex_descriptor& left, const vertex_descriptor& right) const
+		{
+			return m_errs_ref[left] > m_errs_ref[right];
+		}
+	private:
+		const std::vector<Real>& m_errs_ref;
+	};
+
+public:
+	CPGSearchContext()
+		: m_epoch(0)
+	{
+	}
+
+	void Initialize(uint32_t n_vertices)
+	{
+		m_stamps.assign(n_vertices, 0);
+		m_boundStamps.assign(n_vertices, 0);
+		m_errs.assign(n_vertices, CIKChain::ERROR_MIN);
+		m_heap.clear();
+		m_heap.reserve(n_vertices);
+		m_epoch = 0;
+	}
+
+	// a Grow within n_vertices allocates nothing
+	void Reserve(uint32_t n_vertices)
+	{
+		m_stamps.reserve(n_vertices);
+		m_boundStamps.reserve(n_vertices);
+		m_errs.reserve(n_vertices);
+		m_heap.reserve(n_vertices);
+	}
+
+	// the state of the current search is kept, e.g. for the vertices appended by a posture graph overlay
+	void Grow(uint32_t n_vertices)
+	{
+		if (n_vertices <= (uint32_t)m_stamps.size())
+			return;
+		m_stamps.resize(n_vertices, 0);
+		m_boundStamps.resize(n_vertices, 0);
+		m_errs.resize(n_vertices, CIKChain::ERROR_MIN);
+		m_heap.reserve(n_vertices);
+	}
+
+	void Begin()
+	{
+		m_heap.clear();
+		if (0 == ++ m_epoch) // the stamps are reset once in 2^32 searches
+		{
+			std::fill(m_stamps.begin(), m_stamps.end(), 0);
+			std::fill(m_boundStamps.begin(), m_boundStamps.end(), 0);
+			m_epoch = 1;
+		}
+	}
+
+	bool Visited(vertex_descriptor v) const
+	{
+		return m_epoch == m_stamps[v];
+	}
+
+	Real Visit(vertex_descriptor v, Real err)
+	{
+		m_stamps[v] = m_epoch;
+		m_boundStamps[v] = 0;
+		m_errs[v] = err;
+		return err;
+	}
+
+	// the vertex is visited with a lower bound of its error
+	void Bound(vertex_descriptor v, Real err_lb)
+	{
+		m_stamps[v] = m_epoch;
+		m_boundStamps[v] = m_epoch;
+		m_errs[v] = err_lb;
+	}
+
+	bool Bounded(vertex_descriptor v) const
+	{
+		return m_epoch == m_boundStamps[v];
+	}
+
+	Real Err(vertex_descriptor v) const
+	{
+		IKAssert(Visited(v));
+		return m_errs[v];
+	}
+
+	void Push(vertex_descriptor v)
+	{
+		IKAssert(m_heap.size() < m_heap.capacity());
+		m_heap.push_back(v);
+		std::push_heap(m_heap.begin(), m_heap.end(), GreatorThetaErr(m_errs));
+	}
+
+	vertex_descriptor Pop()
+	{
+		std::pop_heap(m_heap.begin(), m_heap.end(), GreatorThetaErr(m_errs));
+		vertex_descriptor v = m_heap.back();
+		m_heap.pop_back();
+		return v;
+	}
+
+	bool Empty() const
+	{
+		return m_heap.empty();
+	}
+
+	// the scratch of the batched evaluation of the unvisited neighbors
+	std::vector<vertex_descriptor>& Batch()
+	{
+		return m_batch;
+	}
+
+	std::vector<Real>& BatchErrs()
+	{
+		return m_batchErrs;
+	}
+
+private:
+	std::vector<uint32_t> m_stamps;
+	std::vector<uint32_t> m_boundStamps;
+	std::vector<Real> m_errs;
+	std::vector<vertex_descriptor> m_heap;
+	std::vector<vertex_descriptor> m_batch;
+	std::vector<Real> m_batchErrs;
+	uint32_t m_epoch;
+};
+
+// the time budget of the searches of a group or a projection worker:
+//	with a positive budget, a search stops at its deadline instead of at a number of evaluations,
+//	the deadline is checked with the monotonic clock once per evaluation (or batch of evaluations).
+//	End returns the time the search actually used for the counters of the group (PG_STATS)
+class CPGSearchDeadline
+{
+public:
+	typedef std::chrono::steady_clock clock;
+public:
+	CPGSearchDeadline()
+		: m_budget_us(0)
+	{
+	}
+
+	void Initialize(int budget_us)
+	{
+		m_budget_us = budget_us;
+	}
+
+	bool Enabled() const
+	{
+		return m_budget_us > 0;
+	}
+
+	void Begin()
+	{
+		m_start = clock::now();
+		m_deadline = m_start + std::chrono::microseconds(m_budget_us);
+	}
+
+	bool Expired() const
+	{
+		return clock::now() >= m_deadline;
+	}
+
+	int64_t End() const
+	{
+		return (int64_t)std::chrono::duration_cast<std::chrono::microseconds>(clock::now() - m_start).count();
+	}
+
+private:
+	int m_budget_us;
+	clock::time_point m_start;
+	clock::time_point m_deadline;
+};
+
+// the runtime graph searches the CSR of a shared graph in place,
+// the search state (the error of a vertex and the active posture) is kept per runtime
+class CPGRuntime
 {
+public:
+	typedef uint32_t vertex_descriptor;
 public:
 	CPGRuntime()
-		: CPGTransition(0)
-		, m_thetas(NULL)
+		: m_shared(NULL)
+		, m_rootRef(NULL)
+		, m_nEefs(0)
 		, m_theta_star(0)
 	{
+		m_resumeBest.theta = 0;
+		m_resumeBest.err = CIKChain::ERROR_MIN;
 	}
 
 	~CPGRuntime()
 	{
-		if (NULL != m_thetas)
-			delete m_thetas;
+		if (NULL != m_shared)
+			CPGRuntimeShared::Release(m_shared);
 	}
 	bool Load(const char* dir, CArtiBodyNode* rootBody);
 
@@ -362,29 +718,201 @@ public:
 		int pose_id_m = m_theta_star;
 		m_theta_star = pose_id;
 		if (UpdatePose)
-			m_thetas->PoseBody<G_SPACE>(pose_id);
+			PoseBody<G_SPACE>(pose_id);
 		return pose_id_m;
 	}
 
 	template<bool G_SPACE>
 	void ApplyActivePosture()
 	{
-		m_thetas->PoseBody<G_SPACE>(m_theta_star);
+		PoseBody<G_SPACE>(m_theta_star);
+	}
+
+	int ActivePosture() const
+	{
+		return (int)m_theta_star;
+	}
+
+	// the vertex of the graph for a vertex of the overlay, for the searches over the graph only
+	int BasePosture(int pose_id) const
+	{
+		return (int)m_overlay.Anchor(pose_id);
+	}
+
+	const CPGRuntimeShared* Shared() const
+	{
+		return m_shared;
 	}
 
 	void GetRefBodyTheta(TransformArchive& atm)
 	{
-		m_thetas->GetRefBodyTM(atm);
+		CPGThetaRuntime::GetBodyTM(m_jointsRef, atm);
+	}
+
+	void GetTheta(int pose_id, TransformArchive& theta) const
+	{
+		if (m_overlay.Contains(pose_id))
+			theta = m_overlay.Theta(pose_id);
+		else
+			m_shared->Thetas().GetTM(m_shared->Transitions().Theta(pose_id), theta);
+	}
+
+	// the end effectors of every posture in the group space: [theta][i_eef],
+	// root is posed through all the postures, it is either the bound body or a clone of it
+	static void ComputeEefs(const CPGRuntimeShared* pg
+						, CArtiBodyNode* root
+						, const std::vector<CArtiBodyNode*>& eefs
+						, std::vector<_TRANSFORM>& eefs_theta);
+
+	// the end effectors of a posed body in the group space: [i_eef]
+	static void SerializeEefs(const std::vector<CArtiBodyNode*>& eefs, _TRANSFORM* eefs_theta);
+
+	void SetEefs(std::vector<_TRANSFORM>& eefs_theta, int n_eefs)
+	{
+		IKAssert(0 == m_overlay.N_Overlay());
+		m_eefs.swap(eefs_theta);
+		m_nEefs = n_eefs;
+		m_overlay.Initialize(&m_shared->Transitions(), n_eefs);
+	}
+
+	// NULL if the end effectors are not precomputed
+	const _TRANSFORM* GetEefs(int pose_id) const
+	{
+		if (m_eefs.empty())
+			return NULL;
+		else if (m_overlay.Contains(pose_id))
+			return m_overlay.Eefs(pose_id);
+		else
+			return &m_eefs[(std::size_t)m_shared->Transitions().Theta(pose_id) * m_nEefs];
+	}
+
+	int N_Eefs() const
+	{
+		return m_nEefs;
+	}
+
+	// the overlay and the search take up to n_overlay vertices without allocations, see CPGOverlay::Reserve
+	void ReserveOverlay(int n_overlay, int n_links)
+	{
+		m_overlay.Reserve(n_overlay, (int)m_jointsRef.size(), n_links);
+		m_search.Reserve(m_overlay.N_Base() + (uint32_t)n_overlay);
 	}
 
-	const TransformArchive& GetTheta(int pose_id)
+	// the vertices grown into the overlay since the last update are taken between 2 searches
+	void UpdateOverlay(const CPGOverlay& overlay)
 	{
-		return m_thetas->GetTM(pose_id);
+		if (overlay.N_Overlay() > m_overlay.N_Overlay())
+		{
+			m_overlay.Update(overlay);
+			m_search.Grow(m_overlay.N_Vertices());
+		}
+	}
+
+	const CPGOverlay& Overlay() const
+	{
+		return m_overlay;
+	}
+
+	// the index is built with the end effectors of SetEefs, off the main thread for the async loading
+	void SetEefIndex(CPGEefIndex& index)
+	{
+		m_eefIndex.Swap(index);
+	}
+
+	// the k postures of the least errors to the goals in the whole graph, 0 if there is no index
+	int NearestEefs(const Real* goals_g, const bool* masks, int k, uint32_t* pose_ids, Real* errs)
+	{
+		return m_eefIndex.Nearest(goals_g, masks, k, pose_ids, errs);
 	}
 
 
 	template<typename LAMBDA_Err, typename LAMBDA_onMin>
 	static int LocalMin(CPGRuntime& graph, LAMBDA_Err kineErr, LAMBDA_onMin onMin)
+	{
+		return LocalMin(graph.m_overlay, graph.m_theta_star, graph.m_search, kineErr, onMin);
+	}
+
+	// LocalMin of which the state is kept in the runtime for the search of the next frame:
+	//	with resume, the search continues from the frontier of the previous search, the visited vertices keep
+	//	their errors and the best vertex is carried over, so the scored vertices are not scored again.
+	//	a search stopped by kineErr leaves the vertex being expanded in the frontier and its unscored neighbors unvisited.
+	//	without resume or with an empty frontier, it starts from the active posture as LocalMin does
+	template<typename LAMBDA_Err, typename LAMBDA_onMin>
+	static int LocalMin_resume(CPGRuntime& graph, bool resume, LAMBDA_Err kineErr, LAMBDA_onMin onMin)
+	{
+		const CPGOverlay& transitions = graph.m_overlay;
+		CPGSearchContext& search = graph.m_search;
+		ThetaErr& theta_err_kp = graph.m_resumeBest;
+		bool stop_err_compu = false;
+		if (!resume
+			|| search.Empty())
+		{
+			search.Begin();
+			vertex_descriptor theta_star_k = graph.m_theta_star;
+			LOGIKVar(LogInfoInt, theta_star_k);
+			Real err_k = kineErr(theta_star_k, &stop_err_compu);
+			if (stop_err_compu)
+				return (int)theta_star_k;
+			search.Visit(theta_star_k, err_k);
+			search.Push(theta_star_k);
+			theta_err_kp.theta = theta_star_k;
+			theta_err_kp.err = err_k;
+		}
+
+		while (!search.Empty()
+			&& !stop_err_compu)
+		{
+			vertex_descriptor theta = search.Pop();
+			Real err = search.Err(theta);
+			bool local_min = true;
+			for (const vertex_descriptor* it_v_n = transitions.AdjacentBegin(theta), * it_v_end = transitions.AdjacentEnd(theta)
+				; it_v_n != it_v_end && !stop_err_compu
+				; it_v_n ++)
+			{
+				vertex_descriptor theta_n = *it_v_n;
+				if (!search.Visited(theta_n))
+				{
+					Real err_n = kineErr(theta_n, &stop_err_compu);
+					if (stop_err_compu)
+						break;
+					search.Visit(theta_n, err_n);
+					search.Push(theta_n);
+					LOGIKVar(LogInfoInt, theta_n);
+					LOGIKVar(LogInfoReal, err_n);
+				}
+				local_min = local_min && (err < search.Err(theta_n));
+			}
+
+			if (stop_err_compu)
+			{
+				search.Push(theta);			// expanded again by the next search
+				break;
+			}
+
+			if (local_min)
+				onMin(theta);
+
+			if (err < theta_err_kp.err)
+			{
+				theta_err_kp.theta = theta;
+				theta_err_kp.err = err;
+			}
+			LOGIKVar(LogInfoInt, theta);
+			LOGIKVar(LogInfoReal, err);
+		}
+
+		IKAssert(theta_err_kp.theta < transitions.N_Vertices());
+
+		return (int)theta_err_kp.theta;
+	}
+
+	// transitions is either the graph (CPGFileMapped) or the graph with its overlay (CPGOverlay)
+	template<typename TRANSITIONS, typename LAMBDA_Err, typename LAMBDA_onMin>
+	static int LocalMin(const TRANSITIONS& transitions
+					, vertex_descriptor theta_star_k
+					, CPGSearchContext& search
+					, LAMBDA_Err kineErr
+					, LAMBDA_onMin onMin)
 	{
 		// auto ErrTheta = [&graph, err](vertex_descriptor theta) -> Real
 		// 	{
@@ -392,70 +920,240 @@ public:
 		// 		return err();
 		// 	};
 
-		class GreatorThetaErr
+		LOGIKVar(LogInfoInt, theta_star_k);
+
+		search.Begin();
+		bool stop_err_compu = false;
+		search.Visit(theta_star_k, kineErr(theta_star_k, &stop_err_compu));
+		search.Push(theta_star_k);
+
+		struct ThetaErr
+		{
+			vertex_descriptor theta;
+			Real err;
+		} theta_err_kp = {theta_star_k, search.Err(theta_star_k)};
+
+		while (!search.Empty()
+			&& !stop_err_compu)
 		{
-		public:
-			explicit GreatorThetaErr(const CPGRuntime& a_graph)
-				: m_graph_ref(a_graph)
+			vertex_descriptor theta = search.Pop();
+			Real err = search.Err(theta);
+			bool local_min = true;
+			for (const vertex_descriptor* it_v_n = transitions.AdjacentBegin(theta), * it_v_end = transitions.AdjacentEnd(theta)
+				; it_v_n != it_v_end && !stop_err_compu
+				; it_v_n ++)
 			{
+				vertex_descriptor theta_n = *it_v_n;
+				if (!search.Visited(theta_n))
+				{
+					Real err_n = search.Visit(theta_n, kineErr(theta_n, &stop_err_compu));
+					search.Push(theta_n);
+					LOGIKVar(LogInfoInt, theta_n);
+					LOGIKVar(LogInfoReal, err_n);
+				}
+				local_min = local_min && (err < search.Err(theta_n));
 			}
-			bool operator()(const vertex_descriptor& left, const vertex_descriptor& right) const
+
+			if (!stop_err_compu && local_min)
+				onMin(theta);
+
+			if (err < theta_err_kp.err)
 			{
-				return m_graph_ref[left].err > m_graph_ref[right].err;
+				theta_err_kp.theta = theta;
+				theta_err_kp.err = err;
 			}
-		private:
-			const CPGRuntime& m_graph_ref;
-		} greator_thetaErr(graph);
+			LOGIKVar(LogInfoInt, theta);
+			LOGIKVar(LogInfoReal, err);
+
+		}
+
+		IKAssert(theta_err_kp.theta < transitions.N_Vertices());
+
+		return (int)theta_err_kp.theta;
+	}
 
-		vertex_descriptor theta_star_k = graph.m_theta_star;
-		IKAssert(!ErrorTagged(graph[theta_star_k]));
+	// the batched LocalMin: the unvisited neighbors of a vertex are collected and scored in 1 call,
+	//	kineErrs(thetas, n_thetas, errs, &stop) returns the number of thetas scored until stop is set,
+	//	the vertices are visited and pushed in the order of LocalMin, so the result is the same
+	template<typename LAMBDA_Errs, typename LAMBDA_onMin>
+	static int LocalMin_batch(const CPGFileMapped& transitions
+							, vertex_descriptor theta_star_k
+							, CPGSearchContext& search
+							, LAMBDA_Errs kineErrs
+							, LAMBDA_onMin onMin)
+	{
 		LOGIKVar(LogInfoInt, theta_star_k);
 
+		std::vector<vertex_descriptor>& batch = search.Batch();
+		std::vector<Real>& batch_errs = search.BatchErrs();
 
-		std::priority_queue<vertex_descriptor, std::vector<vertex_descriptor>, GreatorThetaErr> err_known (greator_thetaErr);
-		// std::queue<vertex_descriptor> err_known;
-		std::list<vertex_descriptor> tagged;
+		search.Begin();
 		bool stop_err_compu = false;
-		graph[theta_star_k].err = kineErr(theta_star_k, &stop_err_compu);
-		tagged.push_back(theta_star_k);
-		err_known.push(theta_star_k);
+		Real err_k = (Real)0;
+		kineErrs(&theta_star_k, 1, &err_k, &stop_err_compu);
+		search.Visit(theta_star_k, err_k);
+		search.Push(theta_star_k);
 
 		struct ThetaErr
 		{
 			vertex_descriptor theta;
 			Real err;
-		} theta_err_kp = {theta_star_k, graph[theta_star_k].err};
+		} theta_err_kp = {theta_star_k, err_k};
 
-		while (!err_known.empty()
+		while (!search.Empty()
 			&& !stop_err_compu)
 		{
-			vertex_descriptor theta = err_known.top();
-			err_known.pop();
-			// vertex_descriptor theta = err_known.front();
-			Real err = graph[theta].err;
-			bool local_min = true;
-			auto vertices_range_neighbors = boost::adjacent_vertices(theta, graph);
-			for (auto it_v_n = vertices_range_neighbors.first
-				; it_v_n != vertices_range_neighbors.second && !stop_err_compu
+			vertex_descriptor theta = search.Pop();
+			Real err = search.Err(theta);
+
+			batch.clear();
+			for (const vertex_descriptor* it_v_n = transitions.AdjacentBegin(theta), * it_v_end = transitions.AdjacentEnd(theta)
+				; it_v_n != it_v_end
 				; it_v_n ++)
 			{
-				vertex_descriptor theta_n = *it_v_n;
-				Real& err_n = graph[theta_n].err;
-				if (!ErrorTagged(err_n))
+				if (!search.Visited(*it_v_n))
 				{
-					err_n = kineErr(theta_n, &stop_err_compu);
-					tagged.push_back(theta_n);
-					err_known.push(theta_n);
-					LOGIKVar(LogInfoInt, theta_n);
-					LOGIKVar(LogInfoReal, err_n);
+					search.Visit(*it_v_n, CIKChain::ERROR_MIN);	// a neighbor is collected once
+					batch.push_back(*it_v_n);
+				}
+			}
+
+			int n_batch = (int)batch.size();
+			if (n_batch > 0)
+			{
+				if ((int)batch_errs.size() < n_batch)
+					batch_errs.resize(n_batch);
+				n_batch = kineErrs(batch.data(), n_batch, batch_errs.data(), &stop_err_compu);
+				for (int i_n = 0; i_n < n_batch; i_n ++)
+				{
+					search.Visit(batch[i_n], batch_errs[i_n]);
+					search.Push(batch[i_n]);
 				}
-				local_min = local_min && (err < err_n);
 			}
 
+			bool local_min = true;
+			for (const vertex_descriptor* it_v_n = transitions.AdjacentBegin(theta), * it_v_end = transitions.AdjacentEnd(theta)
+				; it_v_n != it_v_end && !stop_err_compu && local_min
+				; it_v_n ++)
+				local_min = (err < search.Err(*it_v_n));
+
 			if (!stop_err_compu && local_min)
 				onMin(theta);
 
+			if (err < theta_err_kp.err)
+			{
+				theta_err_kp.theta = theta;
+				theta_err_kp.err = err;
+			}
 			LOGIKVar(LogInfoInt, theta);
+			LOGIKVar(LogInfoReal, err);
+
+		}
+
+		IKAssert(theta_err_kp.theta < transitions.N_Vertices());
+
+		return (int)theta_err_kp.theta;
+	}
+
+	// the LocalMin_batch of an edge weighted graph, for an error of which D = sqrt(2 * err) is a metric
+	// as it is for TransformArchive::Error_q, the edges are weighted with the same error:
+	//	an unvisited neighbor theta_n of theta is bounded with the triangle inequality
+	//		D(theta_n) >= |D(theta) - D(theta, theta_n)| - slack,
+	//	the neighbors bounded below err(theta) are scored in 1 batch as LocalMin_batch does,
+	//	the others are pushed with their bounds and scored only when they reach the top of the heap.
+	//	so the vertices are expanded in the order of LocalMin_batch, and a neighbor that never reaches the top is never scored.
+	//	slack covers the difference between the postures weighting the edges and the postures scored, e.g. the quantization,
+	//	a bound is conservative for the local minimum test
+	template<typename LAMBDA_Errs, typename LAMBDA_onMin>
+	static int LocalMin_bound(const CPGFileMapped& transitions
+							, vertex_descriptor theta_star_k
+							, CPGSearchContext& search
+							, Real slack
+							, LAMBDA_Errs kineErrs
+							, LAMBDA_onMin onMin)
+	{
+		IKAssert(transitions.Weighted());
+		LOGIKVar(LogInfoInt, theta_star_k);
+
+		std::vector<vertex_descriptor>& batch = search.Batch();
+		std::vector<Real>& batch_errs = search.BatchErrs();
+
+		search.Begin();
+		bool stop_err_compu = false;
+		Real err_k = (Real)0;
+		kineErrs(&theta_star_k, 1, &err_k, &stop_err_compu);
+		search.Visit(theta_star_k, err_k);
+		search.Push(theta_star_k);
+
+		struct ThetaErr
+		{
+			vertex_descriptor theta;
+			Real err;
+		} theta_err_kp = {theta_star_k, err_k};
+
+		while (!search.Empty()
+			&& !stop_err_compu)
+		{
+			vertex_descriptor theta = search.Pop();
+			if (search.Bounded(theta))
+			{
+				// a bounded vertex on the top is scored and pushed back with its error
+				Real err_theta = (Real)0;
+				if (kineErrs(&theta, 1, &err_theta, &stop_err_compu) > 0)
+				{
+					search.Visit(theta, err_theta);
+					search.Push(theta);
+				}
+				continue;
+			}
+
+			Real err = search.Err(theta);
+			Real d = sqrt((Real)2 * err);
+
+			batch.clear();
+			const float* it_w_n = transitions.WeightBegin(theta);
+			for (const vertex_descriptor* it_v_n = transitions.AdjacentBegin(theta), * it_v_end = transitions.AdjacentEnd(theta)
+				; it_v_n != it_v_end
+				; it_v_n ++, it_w_n ++)
+			{
+				if (!search.Visited(*it_v_n))
+				{
+					Real d_lb = fabs(d - sqrt((Real)2 * (Real)(*it_w_n))) - slack;
+					Real err_lb = (d_lb > (Real)0) ? (Real)0.5 * d_lb * d_lb : (Real)0;
+					if (err_lb > err)
+					{
+						search.Bound(*it_v_n, err_lb);
+						search.Push(*it_v_n);
+					}
+					else
+					{
+						search.Visit(*it_v_n, CIKChain::ERROR_MIN);	// a neighbor is collected once
+						batch.push_back(*it_v_n);
+					}
+				}
+			}
+
+			int n_batch = (int)batch.size();
+			if (n_batch > 0)
+			{
+				if ((int)batch_errs.size() < n_batch)
+					batch_errs.resize(n_batch);
+				n_batch = kineErrs(batch.data(), n_batch, batch_errs.data(), &stop_err_compu);
+				for (int i_n = 0; i_n < n_batch; i_n ++)
+				{
+					search.Visit(batch[i_n], batch_errs[i_n]);
+					search.Push(batch[i_n]);
+				}
+			}
+
+			bool local_min = true;
+			for (const vertex_descriptor* it_v_n = transitions.AdjacentBegin(theta), * it_v_end = transitions.AdjacentEnd(theta)
+				; it_v_n != it_v_end && !stop_err_compu && local_min
+				; it_v_n ++)
+				local_min = (err < search.Err(*it_v_n));	// err < bound <= error for a bounded neighbor
+
+			if (!stop_err_compu && local_min)
+				onMin(theta);
 
 			if (err < theta_err_kp.err)
 			{
@@ -467,19 +1165,37 @@ public:
 
 		}
 
-		for (auto theta_tagged : tagged)
-			EraseTag(graph[theta_tagged]);
-		IKAssert(-1 < (int)theta_err_kp.theta
-			&& (int)theta_err_kp.theta < graph.m_thetas->N_Theta());
+		IKAssert(theta_err_kp.theta < transitions.N_Vertices());
 
 		return (int)theta_err_kp.theta;
 	}
 
 private:
-	bool LoadThetas(const char* filePath, CArtiBodyNode* body_ref);
+	template<bool G_SPACE>
+	void PoseBody(vertex_descriptor pose_id)
+	{
+		if (m_overlay.Contains(pose_id))
+			CPGThetaRuntime::PoseBody<G_SPACE>(m_overlay.Theta(pose_id), m_jointsRef, m_rootRef);
+		else
+			m_shared->Thetas().PoseBody<G_SPACE>(m_shared->Transitions().Theta(pose_id), m_jointsRef, m_rootRef, m_theta);
+	}
 
-	CPGThetaRuntime* m_thetas;
+private:
+	const CPGRuntimeShared* m_shared;
+	std::vector<IJoint*> m_jointsRef;
+	CArtiBodyNode* m_rootRef;
+	TransformArchive m_theta;			// the decoded active posture
+	std::vector<_TRANSFORM> m_eefs;
+	int m_nEefs;
+	CPGEefIndex m_eefIndex;
+	CPGOverlay m_overlay;				// empty if the graph is not augmented
+	CPGSearchContext m_search;
 	vertex_descriptor m_theta_star;
+	struct ThetaErr
+	{
+		vertex_descriptor theta;
+		Real err;
+	} m_resumeBest;						// the best vertex of the resumable search
 
 };
 
@@ -173,9 +173,7 @@ bool InitBody_Internal_ik(HBODY bodySrc
 		fullPath.append(relpath);
 		try
 		{
-			CIKGroupTree::LoadPG(root_ikGroup
-								, fullPath.generic_u8string().c_str()
-								, body_conf_i->PG_radius());
+			CIKGroupTree::LoadPG(root_ikGroup, fullPath.generic_u8string().c_str(), *body_conf_i);
 		}
 		catch(std::string &exp)
 		{
@@ -501,6 +499,33 @@ void ik_reset(MotionPipe* mopipe)
 	motion_sync(mopipe->mo_nodes[c_idxSim]);
 }
 
+bool ik_pg_ready(MotionPipe* mopipe)
+{
+	MotionPipeInternal* mopipe_internal = static_cast<MotionPipeInternal*>(mopipe);
+	IKAssert(MotionPipeInternal::IK == mopipe_internal->type);
+	return CIKGroupTree::PGReady(mopipe_internal->root_ik);
+}
+
+int ik_pg_stats(MotionPipe* mopipe, PG_Stats* stats, int n_stats)
+{
+#if defined PG_STATS
+	MotionPipeInternal* mopipe_internal = static_cast<MotionPipeInternal*>(mopipe);
+	IKAssert(MotionPipeInternal::IK == mopipe_internal->type);
+	return CIKGroupTree::PGStats(mopipe_internal->root_ik, stats, n_stats);
+#else
+	return 0;
+#endif
+}
+
+void ik_pg_stats_reset(MotionPipe* mopipe)
+{
+#if defined PG_STATS
+	MotionPipeInternal* mopipe_internal = static_cast<MotionPipeInternal*>(mopipe);
+	IKAssert(MotionPipeInternal::IK == mopipe_internal->type);
+	CIKGroupTree::PGStatsReset(mopipe_internal->root_ik);
+#endif
+}
+
 HMOTIONNODE	create_tree_motion_node(HBODY mo_src)
 {
 	CArtiBodyNode* body = CAST_2PBODY(mo_src);
@@ -1,5 +1,7 @@
 #pragma once
 #include <windows.h>
+#include <atomic>
+#include <stdint.h>
 
 class CThread
 {
@@ -234,4 +236,57 @@ private:
 	std::vector<Thread*> m_threads;
 	std::vector<HANDLE> m_readiness_ref; //semaphores
 	std::vector<HANDLE> m_cmdQuits_ref;  //event
-};
\ No newline at end of file
+};
+
+// a triple buffer from a producer thread to a consumer thread, none of them blocks or calls the system:
+//	the producer fills its back slot and publishes it by swapping it with the middle slot,
+//	the consumer takes the middle slot if it is published since the last take, by swapping it with its front slot.
+//	a slot published and not taken yet is replaced by the next publish, so the consumer takes the latest one
+template<typename T>
+class CTripleBuffer
+{
+public:
+	CTripleBuffer()
+		: m_back(0)
+		, m_middle(1)
+		, m_front(2)
+	{
+	}
+
+	T& Back_producer()
+	{
+		return m_slots[m_back];
+	}
+
+	void Publish_producer()
+	{
+		m_back = m_middle.exchange(m_back | c_fresh, std::memory_order_seq_cst) & c_index;
+	}
+
+	bool Fresh_consumer() const
+	{
+		return 0 != (m_middle.load(std::memory_order_seq_cst) & c_fresh);
+	}
+
+	// false if nothing is published since the last take
+	bool Take_consumer()
+	{
+		if (!Fresh_consumer())
+			return false;
+		m_front = m_middle.exchange(m_front, std::memory_order_acq_rel) & c_index;
+		return true;
+	}
+
+	T& Front_consumer()
+	{
+		return m_slots[m_front];
+	}
+
+private:
+	static const uint32_t c_index = 3;
+	static const uint32_t c_fresh = 4;
+	T m_slots[3];
+	uint32_t m_back;
+	std::atomic<uint32_t> m_middle;
+	uint32_t m_front;
+};
@@ -258,7 +258,7 @@ bool posture_graph_gen(const char* interests_conf_path, const char* path_htr, co
 		ok = (NULL != pg);
 		if (ok)
 		{
-			pg->Save(dir_out);
+			ok = pg->Save(dir_out);
 			*n_theta_pg = pg->Theta().N_Theta();
 			delete pg;
 		}
@@ -340,8 +340,29 @@ bool posture_graph_save(HPG hpg, const char* dir_out)
 {
 	CPG* pPG = CAST_2PPG(hpg);
 	if (pPG)
+		return pPG->Save(dir_out);
+	else
+		return false;
+}
+
+bool posture_graph_bound_degree(HPG hpg, int deg_max)
+{
+	CPG* pPG = CAST_2PPG(hpg);
+	if (pPG && deg_max > 0)
 	{
-		pPG->Save(dir_out);
+		pPG->BoundDegree((std::size_t)deg_max);
+		return true;
+	}
+	else
+		return false;
+}
+
+bool posture_graph_add_shortcuts(HPG hpg, int n_links)
+{
+	CPG* pPG = CAST_2PPG(hpg);
+	if (pPG && n_links > 0)
+	{
+		pPG->AddShortcuts(n_links);
 		return true;
 	}
 	else
@@ -350,10 +371,9 @@ bool posture_graph_save(HPG hpg, const char* dir_out)
 
 bool convert_pg2dot(const char* path_src, const char* path_dst)
 {
-	CPGRuntime filePG;
-	filePG.LoadTransitions(path_src);
-	filePG.SaveTransitions(path_dst, F_DOT);
-	return true;
+	CPGTransition filePG(0);
+	return filePG.LoadTransitions(path_src)
+		&& filePG.SaveTransitions(path_dst, F_DOT);
 }
 
 bool trim(const char* src, const char* dst, const char* const names_rm[], int n_names)
@@ -386,18 +406,29 @@ bool trim(const char* src, const char* dst, const char* const names_rm[], int n_
 			CArtiBodyTree::TraverseDFS(rootTrim, OnEnterBodyTrim, OnLeaveBodyTrim);
 
 			CPGThetaRuntime file_src(src, rootTrim);
-			int n_theta = file_src.N_Theta();
-			CArtiBodyRef2File file_dst(rootTrim, n_theta);
+			std::vector<IJoint*> joints;
+			ret = file_src.Bind(rootTrim, joints);
+			if (ret)
+			{
+				TransformArchive theta_i;
+				int n_theta = file_src.N_Theta();
+				CArtiBodyRef2File file_dst(rootTrim, n_theta);
 
-			for (int i_theta = 0; i_theta < n_theta; i_theta ++)
+				for (int i_theta = 0; i_theta < n_theta; i_theta ++)
+				{
+					file_src.PoseBody<false>(i_theta, joints, rootTrim, theta_i);
+					file_dst.UpdateMotion(i_theta);
+				}
+
+				CArtiBodyTree::Destroy(rootTrim);
+				file_dst.WriteBvhFile(dst);
+			}
+			else
 			{
-				file_src.PoseBody<false>(i_theta);
-				file_dst.UpdateMotion(i_theta);
+				LOGIKVarErr(LogInfoCharPtr, src);
+				CArtiBodyTree::Destroy(rootTrim);
 			}
 
-			CArtiBodyTree::Destroy(rootTrim);
-			file_dst.WriteBvhFile(dst);
-
 		}
 	}
 	catch(const std::string &exp)
@@ -1,6 +1,5 @@
 #pragma once
 
-#include <stack>
 #include <queue>
 #include "ik_logger.h"
 #include "articulated_body.h"
@@ -48,36 +47,38 @@ template<typename NodeType>
 class Tree
 {
 public:
+	// the traversal walks the parent and sibling links instead of a stack, so it allocates nothing:
+	//	the links of a node are read before it is left, so OnLeaveBody can destroy the node
 	template<typename LAMaccessEnter, typename LAMaccessLeave>
 	static void TraverseDFS(NodeType* root, LAMaccessEnter OnEnterBody, LAMaccessLeave OnLeaveBody)
 	{
 		assert(NULL != root);
-		typedef struct _EDGE
+		NodeType* body = root;
+		OnEnterBody(body);
+		while (NULL != body)
 		{
-			NodeType* body_this;
-			NodeType* body_child;
-		} EDGE;
-		std::stack<EDGE> stkDFS;
-		stkDFS.push({ root, root->GetFirstChild() });
-		//printArtName(body_name_w(root), 0);
-		OnEnterBody(root);
-		while (!stkDFS.empty())
-		{
-			EDGE &edge = stkDFS.top();
-			// size_t n_indent = stkDFS.size();
-			if (NULL == edge.body_child)
+			NodeType* body_child = body->GetFirstChild();
+			if (NULL != body_child)
+			{
+				OnEnterBody(body_child);
+				body = body_child;
+				continue;
+			}
+			// body is a leaf: it is left with the ancestors of which it is the last child
+			NodeType* body_next = NULL;
+			while (NULL != body
+				&& NULL == body_next)
 			{
-				stkDFS.pop();
-				OnLeaveBody(edge.body_this);
+				bool leaving_root = (root == body);
+				NodeType* body_parent = body->GetParent();
+				body_next = leaving_root ? NULL : body->GetNextSibling();
+				OnLeaveBody(body);
+				body = (leaving_root || NULL != body_next) ? NULL : body_parent;
 			}
-			else
+			if (NULL != body_next)
 			{
-				//printArtName(body_name_w(edge.body_child), n_indent);
-				OnEnterBody(edge.body_child);
-				NodeType* body_grandchild = edge.body_child->GetFirstChild();
-				NodeType* body_nextchild = edge.body_child->GetNextSibling();
-				stkDFS.push({ edge.body_child, body_grandchild });
-				edge.body_child = body_nextchild;
+				OnEnterBody(body_next);
+				body = body_next;
 			}
 		}
 	}
@@ -86,33 +87,34 @@ public:
 	static bool TraverseDFS(const NodeType* root, LAMaccessEnter OnEnterBody, LAMaccessLeave OnLeaveBody)
 	{
 		assert(NULL != root);
-		typedef struct _EDGE
-		{
-			const NodeType* body_this;
-			const NodeType* body_child;
-		} EDGE;
-		std::stack<EDGE> stkDFS;
-		stkDFS.push({ root, root->GetFirstChild() });
-		//printArtName(body_name_w(root), 0);
-		bool walking = OnEnterBody(root);
-		while (!stkDFS.empty()
+		const NodeType* body = root;
+		bool walking = OnEnterBody(body);
+		while (NULL != body
 			&& walking)
 		{
-			EDGE &edge = stkDFS.top();
-			// size_t n_indent = stkDFS.size();
-			if (NULL == edge.body_child)
+			const NodeType* body_child = body->GetFirstChild();
+			if (NULL != body_child)
+			{
+				walking = OnEnterBody(body_child);
+				body = body_child;
+				continue;
+			}
+			const NodeType* body_next = NULL;
+			while (NULL != body
+				&& NULL == body_next
+				&& walking)
 			{
-				stkDFS.pop();
-				walking = OnLeaveBody(edge.body_this);
+				bool leaving_root = (root == body);
+				const NodeType* body_parent = body->GetParent();
+				body_next = leaving_root ? NULL : body->GetNextSibling();
+				walking = OnLeaveBody(body);
+				body = (leaving_root || NULL != body_next) ? NULL : body_parent;
 			}
-			else
+			if (NULL != body_next
+				&& walking)
 			{
-				//printArtName(body_name_w(edge.body_child), n_indent);
-				walking = OnEnterBody(edge.body_child);
-				const NodeType* body_grandchild = edge.body_child->GetFirstChild();
-				const NodeType* body_nextchild = edge.body_child->GetNextSibling();
-				stkDFS.push({ edge.body_child, body_grandchild });
-				edge.body_child = body_nextchild;
+				walking = OnEnterBody(body_next);
+				body = body_next;
 			}
 		}
 		return walking;